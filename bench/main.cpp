@@ -0,0 +1,278 @@
+
+// allegrexplorer_bench: times the load, lookup, format and export hot paths
+// without creating a window.
+//
+// usage: allegrexplorer_bench [--iterations N] [--threads N] [input...]
+// defaults to res/cube.elf. prints one JSON object per line and benchmark.
+
+#include <stdio.h>  // printf, remove
+
+#include "shl/compare.hpp"
+#include "shl/defer.hpp"
+#include "shl/string.hpp"
+
+#include "allegrex/disassemble.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "exporter.hpp"
+#include "instruction_format.hpp"
+#include "module_loader.hpp"
+#include "thread_pool.hpp"
+#include "timer.hpp"
+#include "workspace.hpp"
+
+#define BENCH_LOOKUPS 1000000
+
+struct _bench_result
+{
+    array<u64> durations_ns;
+    s64 items_per_iteration; // instructions, lookups, ...
+};
+
+static thread_pool _workers{};
+
+static void _report(const char *input, const char *name, _bench_result *res)
+{
+    compare_function_p<u64> compare_durations =
+        [](const u64 *l, const u64 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(res->durations_ns.data, res->durations_ns.size, compare_durations);
+
+    s64 n = res->durations_ns.size;
+
+    if (n == 0)
+        return;
+
+    u64 median = res->durations_ns[n / 2];
+    u64 p95 = res->durations_ns[Min((n * 95) / 100, n - 1)];
+    u64 min = res->durations_ns[0];
+    double items_per_s = median > 0 ? (double)res->items_per_iteration / ns_to_s(median) : 0.0;
+
+    printf("{\"input\": \"%s\", \"benchmark\": \"%s\", \"iterations\": %lld, "
+           "\"min_ms\": %.4f, \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+           "\"items\": %lld, \"items_per_s\": %.1f}\n",
+           input, name, (long long)n,
+           ns_to_ms(min), ns_to_ms(median), ns_to_ms(p95),
+           (long long)res->items_per_iteration, items_per_s);
+
+    fflush(stdout);
+}
+
+// deterministic addresses of instructions, so runs are comparable
+static void _lookup_addresses(array<u32> *out)
+{
+    s64 count = actx.disasm.all_instructions.size;
+    u64 state = 0x2545f4914f6cdd1dull;
+
+    for (s64 i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        ::add_at_end(out, actx.disasm.all_instructions[(s64)((state >> 33) % (u64)count)].address);
+    }
+}
+
+static bool _bench_input(const char *input, s64 iterations)
+{
+    _bench_result res{};
+    defer { free(&res.durations_ns); };
+
+    // disassemble_psp_elf alone
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        psp_disassembly disasm{};
+        init(&disasm);
+        error err{};
+
+        u64 start = time_now_ns();
+        bool ok = disassemble_psp_elf(input, &disasm, &err);
+        u64 duration = time_now_ns() - start;
+
+        res.items_per_iteration = disasm.all_instructions.size;
+        free(&disasm);
+
+        if (!ok)
+        {
+            fprintf(stderr, "could not load psp elf from %s\n", input);
+            return false;
+        }
+
+        ::add_at_end(&res.durations_ns, duration);
+    }
+
+    _report(input, "disassemble_psp_elf", &res);
+
+    // full load, decode + analysis
+    clear(&res.durations_ns);
+
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        error err{};
+
+        // the previous iteration's module would otherwise be freed inside
+        // load_module_now, when it replaces the module of the same path
+        while (actx.workspace.modules.size > 0)
+            workspace_close_module(actx.workspace.modules.size - 1);
+
+        u64 start = time_now_ns();
+
+        if (!load_module_now(input, &err))
+            return false;
+
+        ::add_at_end(&res.durations_ns, time_now_ns() - start);
+    }
+
+    res.items_per_iteration = actx.disasm.all_instructions.size;
+    _report(input, "load_module", &res);
+
+    if (actx.disasm.all_instructions.size == 0)
+        return true;
+
+    array<u32> addresses{};
+    defer { free(&addresses); };
+    _lookup_addresses(&addresses);
+
+    // instruction_index_by_vaddr
+    clear(&res.durations_ns);
+    res.items_per_iteration = addresses.size;
+
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        s64 sum = 0;
+        u64 start = time_now_ns();
+
+        for_array(addr, &addresses)
+            sum += instruction_index_by_vaddr(*addr);
+
+        ::add_at_end(&res.durations_ns, time_now_ns() - start);
+
+        if (sum == -1) // keeps the loop from being optimized away
+            printf("\n");
+    }
+
+    _report(input, "instruction_index_by_vaddr", &res);
+
+    // address_label
+    clear(&res.durations_ns);
+
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        s64 sum = 0;
+        u64 start = time_now_ns();
+
+        for_array(addr, &addresses)
+            sum += (s64)address_label(*addr)[0];
+
+        ::add_at_end(&res.durations_ns, time_now_ns() - start);
+
+        if (sum == -1)
+            printf("\n");
+    }
+
+    _report(input, "address_label", &res);
+
+    // format_instruction
+    clear(&res.durations_ns);
+    res.items_per_iteration = actx.disasm.all_instructions.size;
+
+    string line{};
+    defer { free(&line); };
+
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        u64 start = time_now_ns();
+
+        for_array(instr, &actx.disasm.all_instructions)
+        {
+            clear(&line);
+            format_instruction(&line, instr, nullptr);
+        }
+
+        ::add_at_end(&res.durations_ns, time_now_ns() - start);
+    }
+
+    _report(input, "format_instruction", &res);
+
+    // full export
+    const char *export_path = "allegrexplorer_bench_export.s";
+    clear(&res.durations_ns);
+    s64 export_bytes = 0;
+
+    for (s64 it = 0; it < iterations; ++it)
+    {
+        error err{};
+        export_stats stats{};
+
+        if (!export_disassembly(export_path, &stats, &err))
+        {
+            fprintf(stderr, "could not export disassembly to %s\n", export_path);
+            return false;
+        }
+
+        ::add_at_end(&res.durations_ns, stats.duration_ns);
+        export_bytes = stats.bytes;
+    }
+
+    remove(export_path);
+
+    _report(input, "export_disassembly", &res);
+
+    if (res.durations_ns.size > 0)
+        printf("{\"input\": \"%s\", \"benchmark\": \"export_disassembly_throughput\", \"bytes\": %lld, \"mb_per_s\": %.1f}\n",
+               input, (long long)export_bytes,
+               ((double)export_bytes / (1024.0 * 1024.0)) / ns_to_s(Max(res.durations_ns[res.durations_ns.size / 2], (u64)1)));
+
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    s64 iterations = 10;
+    s32 thread_count = 0;
+    array<const char*> inputs{};
+    defer { free(&inputs); };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string_compare(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            const_string end = to_const_string(argv[i + 1]);
+            iterations = Max((s64)string_to_u32(argv[i + 1], &end, 10), (s64)1);
+            i += 1;
+        }
+        else if (string_compare(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            const_string end = to_const_string(argv[i + 1]);
+            thread_count = (s32)string_to_u32(argv[i + 1], &end, 10);
+            i += 1;
+        }
+        else
+            ::add_at_end(&inputs, argv[i]);
+    }
+
+    if (inputs.size == 0)
+        ::add_at_end(&inputs, (const char*)ALLEGREXPLORER_ROOT "/res/cube.elf");
+
+    init(&_workers, thread_count);
+    actx.workers = &_workers;
+    actx.use_analysis_cache = false; // always measure the full load
+    actx.global_alloc = get_context_pointer()->allocator;
+    actx.frame_alloc = actx.global_alloc;
+    init(&actx);
+
+    printf("{\"benchmark\": \"setup\", \"threads\": %d, \"iterations\": %lld}\n",
+           _workers.thread_count, (long long)iterations);
+
+    int ret = 0;
+
+    for_array(input, &inputs)
+        if (!_bench_input(*input, iterations))
+            ret = 1;
+
+    free(&actx);
+    free(&_workers);
+
+    return ret;
+}
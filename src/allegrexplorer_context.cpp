@@ -1,13 +1,20 @@
 
 #include "shl/format.hpp"
 #include "allegrexplorer_context.hpp"
+#include "call_graph_window.hpp"
+#include "cfg_window.hpp"
 #include "disassembly_window.hpp"
+#include "function_browser.hpp"
+#include "pattern_search.hpp"
+#include "popups.hpp"
 
 allegrexplorer_context actx;
 
 void init(allegrexplorer_context *ctx)
 {
     init(&ctx->disasm);
+    init(&ctx->analysis);
+    init(&ctx->workspace);
     init(&ctx->ui);
 
     ctx->last_active_window = window_type::Disassembly;
@@ -21,94 +28,143 @@ void init(allegrexplorer_context *ctx)
 
 void free(allegrexplorer_context *ctx)
 {
+    module_views_clear();
+
     free(&ctx->ui);
+    free(&ctx->analysis);
     free(&ctx->disasm);
+    free(&ctx->workspace);
+}
+
+void module_caches_clear()
+{
+    // searches in progress read the module
+    pattern_search_clear();
+
+    disassembly_line_cache_clear();
+    function_browser_clear();
+    call_graph_window_clear();
+    cfg_window_clear();
+    popup_goto_reset();
+}
 
+void module_views_clear()
+{
+    module_caches_clear();
     disassembly_history_clear();
 }
 
+bool module_analyzing()
+{
+    const module_workspace *ws = &actx.workspace;
+
+    return ws->active >= 0 && ws->modules[ws->active]->analyzing;
+}
+
 const char *address_name(u32 addr)
+{
+    return address_name(&actx.disasm, addr);
+}
+
+const char *address_name(psp_disassembly *disasm, u32 addr)
 {
     // symbols
-    elf_symbol *sym = ::search(&actx.disasm.psp_module.symbols, &addr);
+    elf_symbol *sym = ::search(&disasm->psp_module.symbols, &addr);
 
     if (sym != nullptr)
         return sym->name;
 
     // imports
-    function_import *fimp = ::search(&actx.disasm.psp_module.imports, &addr);
+    function_import *fimp = ::search(&disasm->psp_module.imports, &addr);
 
-    if (fimp != nullptr)
+    if (fimp != nullptr && fimp->function != nullptr)
         return fimp->function->name;
 
     return "";
 }
 
-static int _compare_only_address_ascending_p(const u32 *addr, const jump_destination *r)
-{
-    return compare_ascending(*addr, r->address);
-}
-
 const char *address_label(u32 addr)
 {
+    s64 idx = instruction_index_by_vaddr(addr);
+
+    if (idx >= 0)
+        return instruction_label(idx);
+
+    // not an instruction we disassembled
     const char *aname = address_name(addr);
 
     if (aname != nullptr && aname[0] != '\0')
         return aname;
 
-    constexpr const compare_function_p<u32, jump_destination> comp = _compare_only_address_ascending_p;
+    const char *label = label_table_get_outside(&actx.analysis.labels, addr);
 
-    binary_search_result res = nearest_index_of(&actx.disasm.all_jumps, addr, comp);
+    if (label != nullptr)
+        return label;
 
-    if (res.last_comparison != 0)
-        return "";
+    return "";
+}
 
-    jump_destination *dest = actx.disasm.all_jumps.data + res.index;
+const char *address_label(jump_destination jmp)
+{
+    return address_label(jmp.address);
+}
 
-    const_string ret{};
+const char *instruction_label(s64 index)
+{
+    if (index < 0 || index >= actx.analysis.labels.handles.size)
+        return "";
 
-    if (dest->type == jump_type::Jump)
-        ret = tformat("func_%08x", addr);
-    else
-        ret = tformat(".L%08x", addr);
+    return label_table_get(&actx.analysis.labels, index);
+}
 
-    return ret.c_str;
+s64 instruction_count()
+{
+    return actx.analysis.instructions.addresses.size;
 }
 
-const char *address_label(jump_destination jmp)
+instruction *instruction_at(s64 index, instruction *storage)
 {
-    const char *aname = address_name(jmp.address);
+    if (index < actx.disasm.all_instructions.size)
+        return actx.disasm.all_instructions.data + index;
 
-    if (aname != nullptr && aname[0] != '\0')
-        return aname;
+    instruction_store_unpack(&actx.analysis.store, &actx.analysis.instructions, index, storage);
+    return storage;
+}
 
-    const_string ret{};
+s64 instruction_index_by_vaddr(u32 vaddr)
+{
+    return analysis_instruction_index(&actx.analysis, &actx.disasm, vaddr);
+}
 
-    if (jmp.type == jump_type::Jump)
-        ret = tformat("func_%08x", jmp.address);
-    else
-        ret = tformat(".L%08x", jmp.address);
+u32 instruction_elf_offset(s64 index)
+{
+    return analysis_instruction_elf_offset(&actx.analysis, index);
+}
 
-    return ret.c_str;
+s64 function_index_by_vaddr(u32 vaddr)
+{
+    return function_index_containing(&actx.analysis.functions, vaddr);
 }
 
-s64 instruction_index_by_vaddr(u32 vaddr)
+const char *function_offset_label(u32 vaddr)
 {
-    instruction *instrs = actx.disasm.all_instructions.data;
-    s64 instr_count = actx.disasm.all_instructions.size;
+    s64 f = function_index_by_vaddr(vaddr);
+
+    if (f < 0)
+        return "";
+
+    u32 start = actx.analysis.functions.starts[f];
 
-    compare_function_p<u32, instruction> compare_instruction_vaddr =
-        [](const u32 *l, const instruction *r)
-        {
-            return compare_ascending(*l, r->address);
-        };
+    if (start == vaddr)
+        return address_label(start);
 
-    auto res = binary_search(instrs, instr_count, &vaddr, compare_instruction_vaddr);
+    return tformat("%s+0x%x", address_label(start), vaddr - start).c_str;
+}
 
-    if (res.last_comparison == 0)
-        return res.index;
-    else
-        return -1;
+const char *module_elf_data(s64 *out_size)
+{
+    *out_size = (s64)actx.disasm.psp_module.elf_size;
+    return (const char*)actx.disasm.psp_module.elf_data;
 }
 
 void goto_address(u32 vaddr)
@@ -124,6 +180,14 @@ void goto_address(u32 vaddr)
     }
 }
 
+void goto_module_address(s64 module, u32 vaddr)
+{
+    workspace_activate(module);
+
+    if (module == actx.workspace.active)
+        goto_address(vaddr);
+}
+
 bool history_can_go_back()
 {
     switch (actx.last_active_window)
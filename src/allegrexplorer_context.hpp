@@ -3,9 +3,13 @@
 
 #include "allegrex/disassemble.hpp"
 
+#include "analysis.hpp"
 #include "ui.hpp"
+#include "workspace.hpp"
 
 struct GLFWwindow;
+struct thread_pool;
+struct job_scheduler;
 
 enum class window_type
 {
@@ -19,7 +23,19 @@ struct allegrexplorer_context
     allocator global_alloc;
     allocator frame_alloc;
 
+    // the active module of the workspace
     psp_disassembly disasm;
+    module_analysis analysis;
+
+    // all loaded modules, including the active one
+    module_workspace workspace;
+
+    // live for the entire session, not reset by init / free
+    thread_pool *workers;
+    job_scheduler *scheduler;
+    bool use_analysis_cache;
+    // modules loaded from now on keep packed instructions, see instruction_store.hpp
+    bool compact_instructions;
 
     GLFWwindow *window;
     allegrexplorer_ui ui;
@@ -36,21 +52,51 @@ struct allegrexplorer_context
 void init(allegrexplorer_context *ctx);
 void free(allegrexplorer_context *ctx);
 
+// drops everything windows cached about the data of the active module and
+// stops searches reading it, call before the data of the active module changes.
+void module_caches_clear();
+// same, and forgets the navigation history, call before the active module changes.
+void module_views_clear();
+// whether the late analysis passes of the active module are still running,
+// i.e. functions, call graph, xrefs and the search index are still empty.
+bool module_analyzing();
+
 // the global context
 extern allegrexplorer_context actx;
 
-// gets the name of the address from the context. stored in static storage,
-// may be overwritten, so store the name elsewhere if you need it later.
+// gets the name of the address from the context, or "".
+// names live as long as the module.
 const char *address_name(u32 vaddr);
-// same thing as address_name, but gives unnamed functions and branches labels too
+const char *address_name(psp_disassembly *disasm, u32 vaddr);
+// same thing as address_name, but gives unnamed functions and branches labels too.
+// labels are interned when the module is loaded and live as long as the module.
 const char *address_label(u32 vaddr);
 const char *address_label(jump_destination jmp);
+// label of actx.disasm.all_instructions[index], never null
+const char *instruction_label(s64 index);
+
+// number of instructions of the active module, also in compact mode
+s64 instruction_count();
+// all_instructions[index], or in compact mode the instruction unpacked into storage
+instruction *instruction_at(s64 index, instruction *storage);
 
 // index into context.disasm.all_instructions, or -1 when not found
 s64 instruction_index_by_vaddr(u32 vaddr);
+// elf file offset of context.disasm.all_instructions[index]
+u32 instruction_elf_offset(s64 index);
+// index into context.analysis.functions of the function containing vaddr, or -1
+s64 function_index_by_vaddr(u32 vaddr);
+// "function+0xoffset" of vaddr, or "" if vaddr is in no function.
+// stored in the frame arena.
+const char *function_offset_label(u32 vaddr);
+
+// the decrypted elf of the active module
+const char *module_elf_data(s64 *out_size);
 
 // global controls
 void goto_address(u32 vaddr);
+// activates modules[module] of the workspace and goes to vaddr in it
+void goto_module_address(s64 module, u32 vaddr);
 bool history_can_go_back();
 bool history_can_go_forward();
 void history_go_back();
@@ -23,6 +23,8 @@ static void init(allegrexplorer_settings *settings)
     settings->disassembly.show_instruction_elf_offset = false;
     settings->disassembly.show_instruction_vaddr = true;
     settings->disassembly.show_instruction_opcode = true;
+
+    settings->loading.compact_instructions = false;
 };
 
 static void free(allegrexplorer_settings *settings)
@@ -57,6 +59,8 @@ static void _settings_ReadLineFn(ImGuiContext* ctx, ImGuiSettingsHandler* handle
     if (sscanf(line, "DisassemblyShowInstructionElfOffset=%d", &x) == 1) _settings.disassembly.show_instruction_elf_offset = x == 1;
     if (sscanf(line, "DisassemblyShowInstructionVaddr=%d", &x) == 1)     _settings.disassembly.show_instruction_vaddr = x == 1;
     if (sscanf(line, "DisassemblyShowInstructionOpcode=%d", &x) == 1)    _settings.disassembly.show_instruction_opcode = x == 1;
+
+    if (sscanf(line, "LoadingCompactInstructions=%d", &x) == 1) _settings.loading.compact_instructions = x == 1;
 }
 
 static void _settings_WriteAllFn(ImGuiContext* ctx, ImGuiSettingsHandler* handler, ImGuiTextBuffer* buf)
@@ -72,6 +76,8 @@ static void _settings_WriteAllFn(ImGuiContext* ctx, ImGuiSettingsHandler* handle
     buf->appendf("DisassemblyShowInstructionVaddr=%d\n",     _settings.disassembly.show_instruction_vaddr ? 1 : 0);
     buf->appendf("DisassemblyShowInstructionOpcode=%d\n",    _settings.disassembly.show_instruction_opcode ? 1 : 0);
 
+    buf->appendf("LoadingCompactInstructions=%d\n", _settings.loading.compact_instructions ? 1 : 0);
+
     buf->append("\n");
 }
 
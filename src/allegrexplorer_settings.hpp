@@ -21,6 +21,11 @@ struct allegrexplorer_settings
         bool show_instruction_vaddr;
         bool show_instruction_opcode;
     } disassembly;
+
+    struct _loading
+    {
+        bool compact_instructions;
+    } loading;
 };
 
 void settings_init();
@@ -0,0 +1,475 @@
+
+#include <type_traits>
+
+#include "shl/allocator_arena.hpp"
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "analysis.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+void init(module_analysis *analysis)
+{
+    fill_memory(analysis, 0);
+    init(&analysis->instructions);
+    init(&analysis->store);
+    init(&analysis->labels);
+    init(&analysis->functions);
+    init(&analysis->calls);
+    init(&analysis->xrefs);
+    init(&analysis->search);
+}
+
+void free(module_analysis *analysis)
+{
+    if (analysis->packed)
+    {
+        // everything is in the arena
+        free(analysis->memory);
+        delete analysis->memory;
+        fill_memory(analysis, 0);
+        return;
+    }
+
+    free(&analysis->instructions);
+    free(&analysis->store);
+    free(&analysis->section_offsets);
+    free(&analysis->chunks);
+    free(&analysis->section_ranges);
+    free(&analysis->section_ranges_by_index);
+    free(&analysis->jump_targets);
+    free(&analysis->labels);
+    free(&analysis->section_function_offsets);
+    free(&analysis->section_functions);
+    free(&analysis->functions);
+    free(&analysis->calls);
+    free(&analysis->xrefs);
+    free(&analysis->search);
+
+    // arrays that did fit into the arena before it ran out go with it
+    if (analysis->memory != nullptr)
+    {
+        free(analysis->memory);
+        delete analysis->memory;
+        analysis->memory = nullptr;
+    }
+}
+
+bool instruction_jump_destination(const instruction *instr, jump_destination *out)
+{
+    for (u32 i = 0; i < instr->argument_count; ++i)
+    {
+        const instruction_argument *arg = instr->arguments + i;
+
+        switch (instr->argument_types[i])
+        {
+        case argument_type::Jump_Address:
+            *out = jump_destination{arg->jump_address.data, jump_type::Jump};
+            return true;
+
+        case argument_type::Branch_Address:
+            *out = jump_destination{arg->branch_address.data, jump_type::Branch};
+            return true;
+
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+void build_analysis_chunks(const psp_disassembly *disasm, module_analysis *out)
+{
+    s64 offset = 0;
+    s64 total = disasm->all_instructions.size;
+
+    for_array(sec_i, dsec, &disasm->disassembly_sections)
+    {
+        ::add_at_end(&out->section_offsets, offset);
+
+        s64 count = Min((s64)dsec->instruction_count, total - offset);
+
+        if (count > 0)
+        {
+            section_range range{};
+            range.vaddr = dsec->section->vaddr;
+            range.vaddr_end = dsec->section->vaddr + (u32)(count * (s64)sizeof(u32));
+            range.elf_offset = (u32)dsec->section->content_offset;
+            range.first_index = offset;
+            range.count = count;
+            ::add_at_end(&out->section_ranges, range);
+        }
+
+        for (s64 from = 0; from < count; from += ANALYSIS_CHUNK_SIZE)
+        {
+            s64 to = Min(from + (s64)ANALYSIS_CHUNK_SIZE, count);
+            ::add_at_end(&out->chunks, analysis_chunk{sec_i, offset + from, offset + to});
+        }
+
+        offset += count;
+    }
+
+    // ranges were added in the order of their instructions
+    ::resize(&out->section_ranges_by_index, out->section_ranges.size);
+    copy_memory(out->section_ranges.data, out->section_ranges_by_index.data,
+                out->section_ranges.size * (s64)sizeof(section_range));
+
+    compare_function_p<section_range> compare_ranges =
+        [](const section_range *l, const section_range *r)
+        {
+            return compare_ascending(l->vaddr, r->vaddr);
+        };
+
+    ::sort(out->section_ranges.data, out->section_ranges.size, compare_ranges);
+}
+
+const section_range *analysis_section_range(const module_analysis *analysis, u32 vaddr)
+{
+    const array<section_range> *ranges = &analysis->section_ranges;
+
+    // last section starting at or before vaddr
+    s64 lo = 0;
+    s64 hi = ranges->size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (ranges->data[mid].vaddr <= vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+        return nullptr;
+
+    const section_range *range = ranges->data + (lo - 1);
+
+    if (vaddr >= range->vaddr_end)
+        return nullptr;
+
+    return range;
+}
+
+s64 analysis_instruction_index(const module_analysis *analysis, const psp_disassembly *disasm, u32 vaddr)
+{
+    const section_range *range = analysis_section_range(analysis, vaddr);
+
+    if (range == nullptr || (vaddr & 3) != 0)
+        return -1;
+
+    s64 index = range->first_index + (s64)((vaddr - range->vaddr) / sizeof(u32));
+
+    if (analysis->instructions.addresses.data[index] != vaddr)
+        return -1;
+
+    return index;
+}
+
+u32 analysis_instruction_elf_offset(const module_analysis *analysis, s64 index)
+{
+    const array<section_range> *ranges = &analysis->section_ranges_by_index;
+
+    // last range starting at or before index
+    s64 lo = 0;
+    s64 hi = ranges->size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (ranges->data[mid].first_index <= index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+        return max_value(u32);
+
+    const section_range *range = ranges->data + (lo - 1);
+
+    if (index >= range->first_index + range->count)
+        return max_value(u32);
+
+    return range->elf_offset + (u32)((index - range->first_index) * (s64)sizeof(u32));
+}
+
+// calls f with the name of the group of every array of the analysis and the
+// array, always in the same order. arrays of a group are next to each other.
+template<typename A, typename F>
+static void _for_analysis_arrays(A *a, F f)
+{
+    f("Instruction columns", &a->instructions.addresses);
+    f("Instruction columns", &a->instructions.opcodes);
+    f("Instruction columns", &a->instructions.mnemonics);
+    f("Instruction columns", &a->instructions.flags);
+
+    f("Packed instructions", &a->store.offsets);
+    f("Packed instructions", &a->store.data);
+
+    f("Sections", &a->section_offsets);
+    f("Sections", &a->chunks);
+    f("Sections", &a->section_ranges);
+    f("Sections", &a->section_ranges_by_index);
+    f("Sections", &a->section_function_offsets);
+    f("Sections", &a->section_functions);
+
+    f("Jump targets", &a->jump_targets);
+
+    f("Labels", &a->labels.handles);
+    f("Labels", &a->labels.outside_addresses);
+    f("Labels", &a->labels.outside_handles);
+
+    f("Label names", &a->labels.names.chars);
+
+    f("Functions", &a->functions.starts);
+    f("Functions", &a->functions.ends);
+    f("Functions", &a->functions.first_instructions);
+    f("Functions", &a->functions.instruction_counts);
+    f("Functions", &a->functions.caller_counts);
+    f("Functions", &a->functions.callee_counts);
+    f("Functions", &a->functions.leafs);
+
+    f("Call graph", &a->calls.stub_addresses);
+    f("Call graph", &a->calls.callee_offsets);
+    f("Call graph", &a->calls.callees);
+    f("Call graph", &a->calls.caller_offsets);
+    f("Call graph", &a->calls.callers);
+
+    f("Xrefs", &a->xrefs.targets);
+    f("Xrefs", &a->xrefs.offsets);
+    f("Xrefs", &a->xrefs.sources);
+    f("Xrefs", &a->xrefs.types);
+
+    f("Search index", &a->search.entries);
+    f("Search index", &a->search.trigram_keys);
+    f("Search index", &a->search.trigram_offsets);
+    f("Search index", &a->search.trigram_entries);
+}
+
+// room for every array's alignment padding
+#define ANALYSIS_ARRAY_ALIGNMENT 16
+
+void memory_report_add(memory_report *report, const char *name, s64 bytes)
+{
+    report->total += bytes;
+
+    for (s32 i = 0; i < report->count; ++i)
+    {
+        if (string_compare(report->entries[i].name, name) == 0)
+        {
+            report->entries[i].bytes += bytes;
+            return;
+        }
+    }
+
+    if (report->count < MEMORY_REPORT_MAX_ENTRIES)
+        report->entries[report->count++] = memory_report_entry{name, bytes};
+}
+
+void analysis_memory_report(const module_analysis *analysis, memory_report *report)
+{
+    _for_analysis_arrays(analysis, [report](const char *name, const auto *arr)
+    {
+        memory_report_add(report, name, arr->size * (s64)sizeof(arr->data[0]));
+    });
+}
+
+void compact_instructions(psp_disassembly *disasm, module_analysis *analysis, thread_pool *pool)
+{
+    build_instruction_store(disasm, &analysis->store, pool);
+    release_instructions(disasm);
+}
+
+void release_instructions(psp_disassembly *disasm)
+{
+    free(&disasm->all_instructions);
+
+    // these pointed into all_instructions
+    for_array(dsec, &disasm->disassembly_sections)
+        dsec->instructions = nullptr;
+}
+
+void analysis_pack_copy(const module_analysis *from, module_analysis *out)
+{
+    *out = *from;
+
+    s64 size = 0;
+
+    _for_analysis_arrays(from, [&size](const char *, const auto *arr)
+    {
+        size += arr->size * (s64)sizeof(arr->data[0]) + ANALYSIS_ARRAY_ALIGNMENT;
+    });
+
+    out->memory = new arena{};
+    init(out->memory, size);
+
+    allocator alloc = arena_allocator(out->memory);
+    bool packed = true;
+
+    _for_analysis_arrays(out, [alloc, &packed](const char *, auto *arr)
+    {
+        std::remove_reference_t<decltype(*arr)> copy{};
+
+        if (arr->size == 0)
+        {
+            // don't share whatever from has reserved
+            *arr = copy;
+            return;
+        }
+
+        copy.allocator = alloc;
+        ::resize(&copy, arr->size);
+
+        if (copy.data == nullptr)
+        {
+            // arena is full, this one gets its own allocation
+            packed = false;
+            copy = {};
+            ::resize(&copy, arr->size);
+        }
+
+        copy_memory(arr->data, copy.data, arr->size * (s64)sizeof(arr->data[0]));
+        *arr = copy;
+    });
+
+    // search entries point into the label names
+    const char *old_names = from->labels.names.chars.data;
+    const char *old_names_end = old_names + from->labels.names.chars.size;
+    const char *names = out->labels.names.chars.data;
+
+    if (names != old_names)
+    for_array(e, &out->search.entries)
+        if (e->name >= old_names && e->name < old_names_end)
+            e->name = names + (e->name - old_names);
+
+    out->packed = packed;
+}
+
+void analysis_pack(module_analysis *analysis)
+{
+    if (analysis->memory != nullptr)
+        return;
+
+    module_analysis packed;
+    analysis_pack_copy(analysis, &packed);
+    free(analysis);
+    *analysis = packed;
+}
+
+static void _collect_jump_targets(const psp_disassembly *disasm, module_analysis *out, thread_pool *pool)
+{
+    ::resize(&out->jump_targets, disasm->all_instructions.size);
+
+    // every instruction writes only its own slot, so the output doesn't depend
+    // on how chunks are scheduled.
+    parallel_for(pool, out->chunks.size, [disasm, out](s64 chunk_index)
+    {
+        analysis_chunk *chunk = out->chunks.data + chunk_index;
+
+        for (s64 i = chunk->from; i < chunk->to; ++i)
+        {
+            jump_destination jmp{};
+
+            if ((out->instructions.flags.data[i] & (Instruction_Jump | Instruction_Branch))
+             && instruction_jump_destination(disasm->all_instructions.data + i, &jmp))
+                out->jump_targets.data[i] = jmp.address;
+            else
+                out->jump_targets.data[i] = max_value(u32);
+        }
+    });
+}
+
+static void _collect_section_functions(const psp_disassembly *disasm, module_analysis *out)
+{
+    for_array(dsec, &disasm->disassembly_sections)
+    {
+        ::add_at_end(&out->section_function_offsets, out->section_functions.size);
+
+        for (s32 i = 0; i < dsec->jump_count; ++i)
+            if (dsec->jumps[i].type == jump_type::Jump)
+                ::add_at_end(&out->section_functions, dsec->jumps[i].address);
+    }
+
+    ::add_at_end(&out->section_function_offsets, out->section_functions.size);
+}
+
+void analyze_module_first_passes(psp_disassembly *disasm, module_analysis *out, thread_pool *pool)
+{
+    profile_scope("analysis (first passes)");
+
+    {
+        profile_scope("instruction tables");
+        build_instruction_tables(disasm, &out->instructions, pool);
+    }
+
+    if (!out->loaded_from_cache)
+    {
+        build_analysis_chunks(disasm, out);
+
+        {
+            profile_scope("jump collection");
+            _collect_jump_targets(disasm, out, pool);
+        }
+
+        {
+            profile_scope("label building");
+            build_label_table(disasm, out, &out->labels, pool);
+        }
+    }
+
+    _collect_section_functions(disasm, out);
+}
+
+void run_late_pass(late_pass pass, psp_disassembly *disasm, module_analysis *out, thread_pool *pool)
+{
+    switch (pass)
+    {
+    case late_pass::Functions:
+    {
+        profile_scope("function table");
+        build_function_table(disasm, out, &out->functions, pool);
+        break;
+    }
+    case late_pass::CallGraph:
+    {
+        profile_scope("call graph");
+        build_call_graph(disasm, out, &out->calls, pool);
+        break;
+    }
+    case late_pass::Xrefs:
+    {
+        profile_scope("xref index");
+        build_xref_index(disasm, out, &out->xrefs, pool);
+        break;
+    }
+    case late_pass::SearchIndex:
+    {
+        profile_scope("search index");
+        build_search_index(disasm, out, &out->search);
+        break;
+    }
+    }
+}
+
+void analyze_module_late_passes(psp_disassembly *disasm, module_analysis *out, thread_pool *pool)
+{
+    profile_scope("analysis (late passes)");
+
+    // in order of their dependencies
+    run_late_pass(late_pass::Functions, disasm, out, pool);
+    run_late_pass(late_pass::CallGraph, disasm, out, pool);
+    run_late_pass(late_pass::Xrefs, disasm, out, pool);
+    run_late_pass(late_pass::SearchIndex, disasm, out, pool);
+}
+
+void analyze_module(psp_disassembly *disasm, module_analysis *out, thread_pool *pool)
+{
+    analyze_module_first_passes(disasm, out, pool);
+    analyze_module_late_passes(disasm, out, pool);
+}
@@ -0,0 +1,171 @@
+
+#pragma once
+
+// Data derived from a loaded disassembly. Built once on the loader thread
+// after liballegrex is done, then read-only for the lifetime of the module.
+
+#include "allegrex/disassemble.hpp"
+
+#include "call_graph.hpp"
+#include "functions.hpp"
+#include "instruction_store.hpp"
+#include "instruction_tables.hpp"
+#include "labels.hpp"
+#include "search_index.hpp"
+#include "xrefs.hpp"
+
+struct arena;
+struct thread_pool;
+
+// big sections get split into chunks of at most this many instructions
+// so they can be analyzed on multiple threads.
+#define ANALYSIS_CHUNK_SIZE 16384
+
+struct analysis_chunk
+{
+    s64 section_index;
+    s64 from; // index into all_instructions
+    s64 to;   // exclusive
+};
+
+// contiguous range of instructions of one section
+struct section_range
+{
+    u32 vaddr;
+    u32 vaddr_end;   // exclusive
+    u32 elf_offset;  // file offset of the first instruction
+    s64 first_index; // index into all_instructions
+    s64 count;
+};
+
+struct module_analysis
+{
+    // chunks, jump targets and labels came from the analysis cache
+    bool loaded_from_cache;
+
+    // once the analysis is done its arrays are moved into one arena, so the
+    // module is freed with a single deallocation. packed is set if all of
+    // them made it into the arena.
+    arena *memory;
+    bool packed;
+
+    // addresses, opcodes and flags of all_instructions, always rebuilt
+    instruction_tables instructions;
+
+    // arguments of all_instructions in compact mode, which frees
+    // all_instructions after the analysis. empty otherwise.
+    instruction_store store;
+
+    // index of the first instruction of each section in all_instructions
+    array<s64> section_offsets;
+    array<analysis_chunk> chunks;
+
+    // sections with instructions, sorted by vaddr
+    array<section_range> section_ranges;
+    // the same, sorted by first_index
+    array<section_range> section_ranges_by_index;
+
+    // jump or branch target of every instruction, parallel to all_instructions.
+    // max_value(u32) for instructions that neither jump nor branch.
+    array<u32> jump_targets;
+
+    label_table labels;
+
+    // addresses of the functions (jump targets) of each section, in the
+    // order of the section's jumps. functions of disassembly_sections[i] are
+    // section_functions[section_function_offsets[i] .. section_function_offsets[i+1]]
+    array<s64> section_function_offsets;
+    array<u32> section_functions;
+
+    // boundaries and call counts of all functions, always rebuilt
+    function_table functions;
+
+    // which function calls which, always rebuilt
+    call_graph calls;
+
+    // who refers to which address, always rebuilt
+    xref_index xrefs;
+
+    // names for the Goto popup, always rebuilt, it points into labels
+    search_index search;
+};
+
+void init(module_analysis *analysis);
+void free(module_analysis *analysis);
+
+// splits the sections of disasm into chunks, first step of analyze_module
+void build_analysis_chunks(const psp_disassembly *disasm, module_analysis *out);
+
+// the range of instructions containing vaddr, or nullptr
+const section_range *analysis_section_range(const module_analysis *analysis, u32 vaddr);
+
+// index into all_instructions of the instruction at vaddr, or -1.
+// one search over the (few) sections, then a subtraction.
+s64 analysis_instruction_index(const module_analysis *analysis, const psp_disassembly *disasm, u32 vaddr);
+
+// elf file offset of all_instructions[index], or max_value(u32).
+// one search over the (few) sections, like analysis_instruction_index.
+u32 analysis_instruction_elf_offset(const module_analysis *analysis, s64 index);
+
+#define MEMORY_REPORT_MAX_ENTRIES 24
+
+struct memory_report_entry
+{
+    const char *name; // string literal
+    s64 bytes;
+};
+
+// bytes used by each kind of data of a module
+struct memory_report
+{
+    memory_report_entry entries[MEMORY_REPORT_MAX_ENTRIES];
+    s32 count;
+    s64 total;
+};
+
+// adds bytes to the entry called name, creating it if there is none
+void memory_report_add(memory_report *report, const char *name, s64 bytes);
+
+// adds the bytes used by the arrays of the analysis to report
+void analysis_memory_report(const module_analysis *analysis, memory_report *report);
+
+// compact mode: packs the arguments of all instructions into analysis->store
+// and frees disasm->all_instructions, run after all other passes.
+// instructions are unpacked again with instruction_store_unpack.
+void compact_instructions(psp_disassembly *disasm, module_analysis *analysis, thread_pool *pool);
+// second half of compact_instructions, for when the store was built elsewhere
+void release_instructions(psp_disassembly *disasm);
+
+// moves the arrays of a finished analysis into analysis->memory, sized to
+// fit them exactly. the analysis must not change afterwards.
+void analysis_pack(module_analysis *analysis);
+// same, but copies into out and leaves from alone. out owns all of its arrays,
+// even the ones that didn't fit into the arena.
+void analysis_pack_copy(const module_analysis *from, module_analysis *out);
+
+// runs all analysis passes, each pass split across the pool by chunk.
+// results are identical regardless of the number of threads.
+// passes that were loaded from the analysis cache are skipped.
+void analyze_module(psp_disassembly *disasm, module_analysis *out, thread_pool *pool);
+// the passes the disassembly window needs: instruction tables, chunks, jump
+// targets, labels and section functions.
+void analyze_module_first_passes(psp_disassembly *disasm, module_analysis *out, thread_pool *pool);
+// the rest: function table, call graph, xrefs and the search index.
+// they only read the results of the first passes, so those can be shown meanwhile.
+void analyze_module_late_passes(psp_disassembly *disasm, module_analysis *out, thread_pool *pool);
+
+enum class late_pass
+{
+    Functions,
+    CallGraph,   // needs Functions
+    Xrefs,
+    SearchIndex
+};
+
+#define LATE_PASS_COUNT 4
+
+// runs one of the late passes on its own, the passes it needs have to be done
+void run_late_pass(late_pass pass, psp_disassembly *disasm, module_analysis *out, thread_pool *pool);
+
+// the jump destination the instruction refers to, if any
+bool instruction_jump_destination(const instruction *instr, jump_destination *out);
@@ -0,0 +1,316 @@
+
+#include <stdio.h>  // snprintf, rename
+#include <stdlib.h> // getenv
+#include <string.h> // memcmp
+
+#if Windows
+#include <direct.h> // _mkdir
+#else
+#include <sys/stat.h> // mkdir
+#endif
+
+#include "shl/defer.hpp"
+#include "shl/io.hpp"
+#include "shl/memory.hpp"
+
+#include "allegrexplorer_info.hpp"
+#include "analysis.hpp"
+#include "analysis_cache.hpp"
+#include "mapped_file.hpp"
+
+#define ANALYSIS_CACHE_MAGIC "AXCACHE"
+
+// followed by, in this order:
+//   u32  label handles[instruction_count]
+//   u32  jump targets[instruction_count]
+//   u32  outside label addresses[outside_label_count]
+//   u32  outside label handles[outside_label_count]
+//   char label names[label_names_size]
+struct _cache_header
+{
+    char magic[8];
+    u32 version;
+    char app_version[16];
+
+    u64 input_hash;
+    s64 input_size;
+    // the labels are made from the jumps liballegrex found, so a different
+    // version finding different jumps makes the cache stale
+    u64 jumps_hash;
+
+    s64 instruction_count;
+    s64 jump_count;
+    s64 section_count;
+    s64 outside_label_count;
+    s64 label_names_size;
+};
+
+u64 hash_module_data(const char *data, s64 size)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+
+    for (s64 i = 0; i < size; ++i)
+    {
+        hash ^= (u8)data[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static void _make_directory(const char *path)
+{
+#if Windows
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+// creates the cache directory if needed
+static bool _cache_directory(char *out, s64 out_size)
+{
+#if Windows
+    const char *base = getenv("LOCALAPPDATA");
+
+    if (base == nullptr || base[0] == '\0')
+        return false;
+
+    snprintf(out, (size_t)out_size, "%s\\allegrexplorer", base);
+#else
+    const char *base = getenv("XDG_CACHE_HOME");
+
+    if (base != nullptr && base[0] != '\0')
+        snprintf(out, (size_t)out_size, "%s/allegrexplorer", base);
+    else
+    {
+        base = getenv("HOME");
+
+        if (base == nullptr || base[0] == '\0')
+            return false;
+
+        snprintf(out, (size_t)out_size, "%s/.cache", base);
+        _make_directory(out);
+        snprintf(out, (size_t)out_size, "%s/.cache/allegrexplorer", base);
+    }
+#endif
+
+    _make_directory(out);
+
+    return true;
+}
+
+static bool _cache_file_path(u64 input_hash, const char *extension, char *out, s64 out_size)
+{
+    char dir[4096];
+
+    if (!_cache_directory(dir, 4096))
+        return false;
+
+    snprintf(out, (size_t)out_size, "%s/%016llx.%s", dir, (unsigned long long)input_hash, extension);
+
+    return true;
+}
+
+// writes to a temporary file first so readers never see half written files
+static bool _write_file(const char *path, const void **parts, const s64 *sizes, s64 part_count)
+{
+    char tmp_path[4096];
+    snprintf(tmp_path, 4096, "%s.tmp", path);
+
+    error err{};
+    io_handle f = io_open(tmp_path, open_mode::WriteTrunc, &err);
+
+    if (f == INVALID_IO_HANDLE)
+        return false;
+
+    bool ok = true;
+
+    for (s64 i = 0; i < part_count && ok; ++i)
+        if (sizes[i] > 0)
+            ok = io_write(f, (const char*)parts[i], sizes[i], &err) >= 0;
+
+    io_close(f);
+
+    if (!ok)
+    {
+        remove(tmp_path);
+        return false;
+    }
+
+    remove(path);
+    return rename(tmp_path, path) == 0;
+}
+
+bool analysis_cache_elf_path(u64 input_hash, char *out, s64 out_size)
+{
+    return _cache_file_path(input_hash, "elf", out, out_size);
+}
+
+bool analysis_cache_store_elf(u64 input_hash, const psp_disassembly *disasm)
+{
+    char path[4096];
+
+    if (!analysis_cache_elf_path(input_hash, path, 4096))
+        return false;
+
+    const void *parts[] = { disasm->psp_module.elf_data };
+    s64 sizes[] = { (s64)disasm->psp_module.elf_size };
+
+    return _write_file(path, parts, sizes, 1);
+}
+
+static u64 _hash_jumps(const psp_disassembly *disasm)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+
+    for_array(jmp, &disasm->all_jumps)
+    {
+        u64 value = ((u64)jmp->address << 8) | (u64)(u8)jmp->type;
+
+        for (s32 i = 0; i < 8; ++i)
+        {
+            hash ^= (u8)(value >> (i * 8));
+            hash *= 0x100000001b3ull;
+        }
+    }
+
+    return hash;
+}
+
+static void _fill_header(_cache_header *header, u64 input_hash, s64 input_size, const psp_disassembly *disasm)
+{
+    fill_memory(header, 0);
+    copy_memory(ANALYSIS_CACHE_MAGIC, header->magic, sizeof(ANALYSIS_CACHE_MAGIC));
+    header->version = ANALYSIS_CACHE_VERSION;
+    snprintf(header->app_version, sizeof(header->app_version), "%s", allegrexplorer_VERSION);
+    header->input_hash = input_hash;
+    header->input_size = input_size;
+    header->jumps_hash = _hash_jumps(disasm);
+    header->instruction_count = disasm->all_instructions.size;
+    header->jump_count = disasm->all_jumps.size;
+    header->section_count = disasm->disassembly_sections.size;
+}
+
+bool analysis_cache_load(u64 input_hash, s64 input_size, const psp_disassembly *disasm, module_analysis *analysis)
+{
+    char path[4096];
+
+    if (!_cache_file_path(input_hash, "analysis", path, 4096))
+        return false;
+
+    mapped_file mf{};
+
+    if (!map_file(path, &mf))
+        return false;
+
+    defer { free(&mf); };
+
+    if (mf.size < (s64)sizeof(_cache_header))
+        return false;
+
+    _cache_header expected{};
+    _fill_header(&expected, input_hash, input_size, disasm);
+
+    _cache_header header{};
+    copy_memory(mf.data, &header, sizeof(_cache_header));
+
+    expected.outside_label_count = header.outside_label_count;
+    expected.label_names_size = header.label_names_size;
+
+    // covers magic, versions, input and shape of the disassembly
+    if (memcmp(&header, &expected, sizeof(_cache_header)) != 0)
+        return false;
+
+    s64 count = header.instruction_count;
+    s64 outside_count = header.outside_label_count;
+    s64 table_size = count * (s64)sizeof(u32);
+    s64 outside_table_size = outside_count * (s64)sizeof(u32);
+
+    if (header.label_names_size <= 0 || outside_count < 0
+     || mf.size != (s64)sizeof(_cache_header) + 2 * table_size + 2 * outside_table_size + header.label_names_size)
+        return false;
+
+    const char *handles = mf.data + sizeof(_cache_header);
+    const char *jump_targets = handles + table_size;
+    const char *outside_addresses = jump_targets + table_size;
+    const char *outside_handles = outside_addresses + outside_table_size;
+    const char *names = outside_handles + outside_table_size;
+
+    // label handles must stay inside the names, and the names must end with a NUL
+    if (names[header.label_names_size - 1] != '\0')
+        return false;
+
+    build_analysis_chunks(disasm, analysis);
+
+    label_table *labels = &analysis->labels;
+
+    ::resize(&labels->handles, count);
+    ::resize(&analysis->jump_targets, count);
+    ::resize(&labels->outside_addresses, outside_count);
+    ::resize(&labels->outside_handles, outside_count);
+    ::resize(&labels->names.chars, header.label_names_size);
+
+    copy_memory(handles, labels->handles.data, table_size);
+    copy_memory(jump_targets, analysis->jump_targets.data, table_size);
+    copy_memory(outside_addresses, labels->outside_addresses.data, outside_table_size);
+    copy_memory(outside_handles, labels->outside_handles.data, outside_table_size);
+    copy_memory(names, labels->names.chars.data, header.label_names_size);
+
+    bool valid = labels->names.chars.data[0] == '\0';
+
+    for_array(handle, &labels->handles)
+        valid &= *handle < (u32)header.label_names_size;
+
+    for_array(handle, &labels->outside_handles)
+        valid &= *handle < (u32)header.label_names_size;
+
+    if (!valid)
+    {
+        free(analysis);
+        init(analysis);
+        return false;
+    }
+
+    analysis->loaded_from_cache = true;
+
+    return true;
+}
+
+bool analysis_cache_store(u64 input_hash, s64 input_size, const psp_disassembly *disasm, const module_analysis *analysis)
+{
+    char path[4096];
+
+    if (!_cache_file_path(input_hash, "analysis", path, 4096))
+        return false;
+
+    _cache_header header{};
+    _fill_header(&header, input_hash, input_size, disasm);
+    const label_table *labels = &analysis->labels;
+
+    header.outside_label_count = labels->outside_addresses.size;
+    header.label_names_size = labels->names.chars.size;
+
+    s64 table_size = disasm->all_instructions.size * (s64)sizeof(u32);
+    s64 outside_table_size = labels->outside_addresses.size * (s64)sizeof(u32);
+
+    const void *parts[] = {
+        &header,
+        labels->handles.data,
+        analysis->jump_targets.data,
+        labels->outside_addresses.data,
+        labels->outside_handles.data,
+        labels->names.chars.data
+    };
+
+    s64 sizes[] = {
+        (s64)sizeof(_cache_header),
+        table_size,
+        table_size,
+        outside_table_size,
+        outside_table_size,
+        labels->names.chars.size
+    };
+
+    return _write_file(path, parts, sizes, 6);
+}
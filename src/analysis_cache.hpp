@@ -0,0 +1,30 @@
+
+#pragma once
+
+// On-disk cache of decrypted elfs and analysis results, keyed by a hash of
+// the input file, so reopening a module skips decryption and analysis.
+// Cache files are validated on load and ignored if stale or corrupt.
+
+#include "shl/number_types.hpp"
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+
+// bump when the layout or contents of the analysis change
+#define ANALYSIS_CACHE_VERSION 3
+
+// FNV-1a, 64 bit
+u64 hash_module_data(const char *data, s64 size);
+
+// path of the cached decrypted elf for the given input, false if there is
+// no cache directory. the file may not exist.
+bool analysis_cache_elf_path(u64 input_hash, char *out, s64 out_size);
+
+// stores the decrypted elf of disasm for the given input
+bool analysis_cache_store_elf(u64 input_hash, const psp_disassembly *disasm);
+
+// fills analysis from the cache, false if there is no valid cache entry
+// for the input and disasm, in which case analysis is left empty.
+bool analysis_cache_load(u64 input_hash, s64 input_size, const psp_disassembly *disasm, module_analysis *analysis);
+bool analysis_cache_store(u64 input_hash, s64 input_size, const psp_disassembly *disasm, const module_analysis *analysis);
@@ -0,0 +1,207 @@
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+
+#include "analysis.hpp"
+#include "call_graph.hpp"
+#include "thread_pool.hpp"
+
+void init(call_graph *graph)
+{
+    fill_memory(graph, 0);
+}
+
+void free(call_graph *graph)
+{
+    free(&graph->stub_addresses);
+    free(&graph->callee_offsets);
+    free(&graph->callees);
+    free(&graph->caller_offsets);
+    free(&graph->callers);
+    graph->node_count = 0;
+    graph->function_count = 0;
+}
+
+static s64 _stub_index(const call_graph *graph, u32 vaddr)
+{
+    s64 lo = 0;
+    s64 hi = graph->stub_addresses.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (graph->stub_addresses.data[mid] < vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < graph->stub_addresses.size && graph->stub_addresses.data[lo] == vaddr)
+        return lo;
+
+    return -1;
+}
+
+s64 call_graph_node_at(const module_analysis *analysis, u32 vaddr)
+{
+    s64 f = function_index_at(&analysis->functions, vaddr);
+
+    if (f >= 0)
+        return f;
+
+    s64 stub = _stub_index(&analysis->calls, vaddr);
+
+    if (stub >= 0)
+        return analysis->calls.function_count + stub;
+
+    return -1;
+}
+
+u32 call_graph_node_address(const module_analysis *analysis, s64 node)
+{
+    const call_graph *graph = &analysis->calls;
+
+    if (node < graph->function_count)
+        return analysis->functions.starts.data[node];
+
+    return graph->stub_addresses.data[node - graph->function_count];
+}
+
+void build_call_graph(psp_disassembly *disasm, module_analysis *analysis, call_graph *out, thread_pool *pool)
+{
+    const function_table *functions = &analysis->functions;
+
+    for_hash_table(addr, fimp, &disasm->psp_module.imports)
+        if (function_index_at(functions, *addr) < 0)
+            ::add_at_end(&out->stub_addresses, *addr);
+
+    compare_function_p<u32> compare_u32 =
+        [](const u32 *l, const u32 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(out->stub_addresses.data, out->stub_addresses.size, compare_u32);
+
+    s64 function_count = functions->count;
+    out->function_count = function_count;
+    out->node_count = function_count + out->stub_addresses.size;
+
+    // one pass over the instructions of every function, collecting its
+    // distinct callees.
+    array<array<u32>> function_callees{};
+
+    for (s64 f = 0; f < function_count; ++f)
+        ::add_at_end(&function_callees, array<u32>{});
+
+    parallel_for(pool, function_count, [analysis, out, &function_callees, compare_u32](s64 f)
+    {
+        const function_table *functions = &analysis->functions;
+        array<u32> *callees = function_callees.data + f;
+        s64 first = functions->first_instructions.data[f];
+        s64 last = first + functions->instruction_counts.data[f];
+
+        for (s64 i = first; i < last; ++i)
+        {
+            u32 target = analysis->jump_targets.data[i];
+
+            if (target == max_value(u32))
+                continue;
+
+            s64 callee = function_index_at(functions, target);
+
+            if (callee < 0)
+            {
+                s64 stub = _stub_index(out, target);
+
+                if (stub < 0)
+                    continue;
+
+                callee = out->function_count + stub;
+            }
+
+            // calls (jal, bal, bgezal, ...) and tail calls (j). other
+            // branches and a j back to our own start are loops.
+            u8 flags = analysis->instructions.flags.data[i];
+
+            if (!(flags & Instruction_Call) && !(flags & Instruction_Jump))
+                continue;
+
+            if (!(flags & Instruction_Call) && callee == f)
+                continue;
+
+            ::add_at_end(callees, (u32)callee);
+        }
+
+        ::sort(callees->data, callees->size, compare_u32);
+
+        s64 unique = 0;
+
+        for_array(j, callee, callees)
+            if (j == 0 || *callee != callees->data[unique - 1])
+                callees->data[unique++] = *callee;
+
+        callees->size = unique;
+    });
+
+    // callees, in node order
+    ::resize(&out->callee_offsets, out->node_count + 1);
+    ::resize(&out->caller_offsets, out->node_count + 1);
+
+    for (s64 n = 0; n <= out->node_count; ++n)
+    {
+        out->callee_offsets.data[n] = 0;
+        out->caller_offsets.data[n] = 0;
+    }
+
+    u32 edge_count = 0;
+
+    for (s64 n = 0; n < out->node_count; ++n)
+    {
+        out->callee_offsets.data[n] = edge_count;
+
+        if (n < function_count)
+            edge_count += (u32)function_callees.data[n].size;
+    }
+
+    out->callee_offsets.data[out->node_count] = edge_count;
+    ::resize(&out->callees, edge_count);
+
+    for (s64 f = 0; f < function_count; ++f)
+    {
+        array<u32> *callees = function_callees.data + f;
+
+        if (callees->size > 0)
+            copy_memory(callees->data, out->callees.data + out->callee_offsets.data[f], callees->size * (s64)sizeof(u32));
+
+        free(callees);
+    }
+
+    free(&function_callees);
+
+    // callers by counting: iterating callers in node order keeps every
+    // caller list sorted.
+    for_array(callee, &out->callees)
+        out->caller_offsets.data[*callee + 1] += 1;
+
+    for (s64 n = 0; n < out->node_count; ++n)
+        out->caller_offsets.data[n + 1] += out->caller_offsets.data[n];
+
+    ::resize(&out->callers, edge_count);
+
+    array<u32> cursor{};
+    ::resize(&cursor, out->node_count);
+
+    for (s64 n = 0; n < out->node_count; ++n)
+        cursor.data[n] = out->caller_offsets.data[n];
+
+    for (s64 n = 0; n < function_count; ++n)
+    for (u32 e = out->callee_offsets.data[n]; e < out->callee_offsets.data[n + 1]; ++e)
+    {
+        u32 callee = out->callees.data[e];
+        out->callers.data[cursor.data[callee]++] = (u32)n;
+    }
+
+    free(&cursor);
+}
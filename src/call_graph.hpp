@@ -0,0 +1,38 @@
+
+#pragma once
+
+// Which function calls which, for the whole module. Nodes are the functions
+// of the function table, followed by import stubs that were not
+// disassembled. Built once at load, CSR style in both directions, so
+// expanding a node is reading a slice.
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+struct thread_pool;
+
+struct call_graph
+{
+    s64 node_count;
+    s64 function_count; // nodes [0, function_count) are functions
+
+    // node function_count + i is the import stub at stub_addresses[i], sorted
+    array<u32> stub_addresses;
+
+    // distinct callees of node n are callees[callee_offsets[n] .. callee_offsets[n+1]],
+    // sorted by node. same for callers.
+    array<u32> callee_offsets;
+    array<u32> callees;
+    array<u32> caller_offsets;
+    array<u32> callers;
+};
+
+void init(call_graph *graph);
+void free(call_graph *graph);
+
+// analysis must have its function table built already
+void build_call_graph(psp_disassembly *disasm, module_analysis *analysis, call_graph *out, thread_pool *pool);
+
+// node of the function or import stub starting at vaddr, or -1
+s64 call_graph_node_at(const module_analysis *analysis, u32 vaddr);
+u32 call_graph_node_address(const module_analysis *analysis, s64 node);
@@ -0,0 +1,129 @@
+
+#include "imgui.h"
+
+#include "allegrexplorer_context.hpp"
+#include "call_graph_window.hpp"
+#include "disassembly_window.hpp"
+
+// deeper trees are possible but not useful
+#define CALL_TREE_MAX_DEPTH 64
+
+struct _call_tree
+{
+    bool show_callers;
+
+    // nodes from the root to the node being drawn, to spot recursion
+    s64 path[CALL_TREE_MAX_DEPTH];
+    s64 depth;
+
+    u32 clicked;
+};
+
+static void _call_tree_node(_call_tree *tree, s64 node)
+{
+    const call_graph *graph = &actx.analysis.calls;
+    u32 addr = call_graph_node_address(&actx.analysis, node);
+
+    const array<u32> *offsets = tree->show_callers ? &graph->caller_offsets : &graph->callee_offsets;
+    const array<u32> *edges   = tree->show_callers ? &graph->callers        : &graph->callees;
+
+    u32 first = offsets->data[node];
+    u32 count = offsets->data[node + 1] - first;
+
+    bool recursive = false;
+
+    for (s64 i = 0; i < tree->depth; ++i)
+        recursive |= tree->path[i] == node;
+
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth;
+
+    if (count == 0 || recursive || tree->depth >= CALL_TREE_MAX_DEPTH)
+        flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+
+    bool open = ImGui::TreeNodeEx((void*)(intptr_t)node, flags, "%08x %s%s (%u)",
+                                  addr, address_label(addr), recursive ? " (recursive)" : "", count);
+
+    if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
+        tree->clicked = addr;
+
+    if (!open || (flags & ImGuiTreeNodeFlags_NoTreePushOnOpen))
+        return;
+
+    // children are only visited when the node is open
+    tree->path[tree->depth++] = node;
+
+    for (u32 e = first; e < first + count; ++e)
+        _call_tree_node(tree, edges->data[e]);
+
+    tree->depth -= 1;
+    ImGui::TreePop();
+}
+
+static int _mode = 0; // 0 = callees, 1 = callers
+
+// root of the tree, follows the disassembly unless a node was clicked
+static s64 _root = -1;
+static u32 _followed_address = max_value(u32);
+
+void call_graph_window_clear()
+{
+    // modules are often linked at the same base, so the address alone
+    // doesn't tell that the root belongs to another function table.
+    _root = -1;
+    _followed_address = max_value(u32);
+}
+
+void call_graph_window()
+{
+    if (module_analyzing())
+    {
+        // look the root up again once the functions are there
+        _followed_address = max_value(u32);
+
+        if (ImGui::Begin("Call Graph"))
+            ImGui::TextDisabled("Analyzing...");
+
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Begin("Call Graph"))
+    {
+        ImGui::RadioButton("Callees", &_mode, 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("Callers", &_mode, 1);
+
+        u32 current = disassembly_current_address();
+
+        if (current != _followed_address)
+        {
+            _followed_address = current;
+            _root = function_index_by_vaddr(current);
+        }
+
+        ImGui::PushFont(actx.ui.fonts.mono);
+
+        if (_root < 0 || _root >= actx.analysis.functions.count)
+            ImGui::TextDisabled("no function at %08x", current);
+        else
+        {
+            _call_tree tree{};
+            tree.show_callers = _mode == 1;
+            tree.clicked = max_value(u32);
+
+            ImGui::PushID(_mode);
+            _call_tree_node(&tree, _root);
+            ImGui::PopID();
+
+            if (tree.clicked != max_value(u32))
+            {
+                goto_address(tree.clicked);
+                _followed_address = disassembly_current_address();
+            }
+        }
+
+        ImGui::PopFont();
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,8 @@
+
+#pragma once
+
+// callers / callees of the function at the current disassembly address,
+// as a tree that is expanded on demand
+void call_graph_window();
+// forgets the root, call when the functions of the active module change
+void call_graph_window_clear();
@@ -0,0 +1,255 @@
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+
+#include "analysis.hpp"
+#include "cfg.hpp"
+
+// space between blocks, in characters / lines
+#define CFG_GAP_X 4.f
+#define CFG_GAP_Y 3.f
+
+void init(function_cfg *cfg)
+{
+    fill_memory(cfg, 0);
+}
+
+void free(function_cfg *cfg)
+{
+    free(&cfg->block_starts);
+    free(&cfg->edge_offsets);
+    free(&cfg->edge_targets);
+    free(&cfg->block_x);
+    free(&cfg->block_y);
+}
+
+// instructions ending a block after their delay slot. calls don't, they
+// return to the next instruction.
+#define BLOCK_END_FLAGS (Instruction_Conditional | Instruction_Unconditional | Instruction_Return)
+
+s64 cfg_block_of(const function_cfg *cfg, s64 instruction_index)
+{
+    if (cfg->block_count == 0
+     || instruction_index < cfg->block_starts.data[0]
+     || instruction_index >= cfg->block_starts.data[cfg->block_count])
+        return -1;
+
+    // last block starting at or before instruction_index
+    s64 lo = 0;
+    s64 hi = cfg->block_count;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (cfg->block_starts.data[mid] <= instruction_index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo - 1;
+}
+
+static void _add_edge(function_cfg *cfg, s64 from_edge, s64 target)
+{
+    if (target < 0)
+        return;
+
+    for (s64 e = from_edge; e < cfg->edge_targets.size; ++e)
+        if (cfg->edge_targets.data[e] == (u32)target)
+            return;
+
+    ::add_at_end(&cfg->edge_targets, (u32)target);
+}
+
+void build_function_cfg(const psp_disassembly *disasm, const module_analysis *analysis, s64 function, function_cfg *out)
+{
+    const function_table *functions = &analysis->functions;
+    const u8 *flags = analysis->instructions.flags.data;
+
+    out->function = function;
+
+    u32 start = functions->starts.data[function];
+    u32 end = functions->ends.data[function];
+    s64 first = functions->first_instructions.data[function];
+    s64 last = first + functions->instruction_counts.data[function];
+
+    // block leaders: the entry, everything jumped to and everything after a delay slot
+    array<u32> *leaders = &out->block_starts;
+    ::add_at_end(leaders, (u32)first);
+
+    s64 lo = 0;
+    s64 hi = disasm->all_jumps.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (disasm->all_jumps.data[mid].address < start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (s64 j = lo; j < disasm->all_jumps.size && disasm->all_jumps.data[j].address < end; ++j)
+        ::add_at_end(leaders, (u32)(first + (disasm->all_jumps.data[j].address - start) / sizeof(u32)));
+
+    for (s64 i = first; i < last; ++i)
+        if ((flags[i] & BLOCK_END_FLAGS) && i + 2 < last)
+            ::add_at_end(leaders, (u32)(i + 2));
+
+    compare_function_p<u32> compare_leaders =
+        [](const u32 *l, const u32 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(leaders->data, leaders->size, compare_leaders);
+
+    // unique
+    s64 count = 0;
+
+    for_array(i, leader, leaders)
+        if (i == 0 || *leader != leaders->data[count - 1])
+            leaders->data[count++] = *leader;
+
+    leaders->size = count;
+    out->block_count = count;
+    ::add_at_end(leaders, (u32)last);
+
+    // edges, from the branch ending a block (the one before its delay slot)
+    for (s64 b = 0; b < out->block_count; ++b)
+    {
+        s64 block_first = out->block_starts.data[b];
+        s64 block_end = out->block_starts.data[b + 1];
+        s64 edge_start = out->edge_targets.size;
+
+        ::add_at_end(&out->edge_offsets, (u32)edge_start);
+
+        s64 term = -1;
+
+        if (block_end - 2 >= block_first && (flags[block_end - 2] & BLOCK_END_FLAGS))
+            term = block_end - 2;
+        else if (flags[block_end - 1] & BLOCK_END_FLAGS)
+            term = block_end - 1;
+
+        s64 next = block_end < last ? b + 1 : -1;
+
+        if (term < 0)
+        {
+            _add_edge(out, edge_start, next);
+            continue;
+        }
+
+        u32 target = analysis->jump_targets.data[term];
+        s64 target_block = -1;
+
+        if (target >= start && target < end)
+            target_block = cfg_block_of(out, first + (target - start) / sizeof(u32));
+
+        if (flags[term] & Instruction_Conditional)
+        {
+            _add_edge(out, edge_start, target_block);
+            _add_edge(out, edge_start, next);
+        }
+        else if (flags[term] & Instruction_Unconditional)
+            _add_edge(out, edge_start, target_block);
+    }
+
+    ::add_at_end(&out->edge_offsets, (u32)out->edge_targets.size);
+}
+
+void layout_function_cfg(function_cfg *cfg)
+{
+    s64 count = cfg->block_count;
+
+    // row of every block: longest path from the entry over forward edges.
+    // blocks are in address order, so forward edges always go to higher indices.
+    array<u32> rows{};
+    ::resize(&rows, count);
+
+    for (s64 b = 0; b < count; ++b)
+        rows.data[b] = 0;
+
+    u32 row_count = count > 0 ? 1 : 0;
+
+    for (s64 b = 0; b < count; ++b)
+    for (u32 e = cfg->edge_offsets.data[b]; e < cfg->edge_offsets.data[b + 1]; ++e)
+    {
+        u32 t = cfg->edge_targets.data[e];
+
+        if ((s64)t > b && rows.data[t] < rows.data[b] + 1)
+        {
+            rows.data[t] = rows.data[b] + 1;
+            row_count = Max(row_count, rows.data[t] + 1);
+        }
+    }
+
+    // width and height of every row
+    array<u32> row_blocks{};
+    array<float> row_heights{};
+    ::resize(&row_blocks, row_count);
+    ::resize(&row_heights, row_count);
+
+    for (u32 r = 0; r < row_count; ++r)
+    {
+        row_blocks.data[r] = 0;
+        row_heights.data[r] = 0;
+    }
+
+    ::resize(&cfg->block_x, count);
+    ::resize(&cfg->block_y, count);
+
+    for (s64 b = 0; b < count; ++b)
+    {
+        u32 r = rows.data[b];
+
+        // x is the position in the row for now
+        cfg->block_x.data[b] = (float)row_blocks.data[r];
+        row_blocks.data[r] += 1;
+
+        // + 1 for the label
+        float height = (float)(cfg->block_starts.data[b + 1] - cfg->block_starts.data[b] + 1);
+        row_heights.data[r] = Max(row_heights.data[r], height);
+    }
+
+    u32 widest_row = 0;
+
+    for (u32 r = 0; r < row_count; ++r)
+        widest_row = Max(widest_row, row_blocks.data[r]);
+
+    cfg->width = (float)widest_row * (CFG_BLOCK_WIDTH + CFG_GAP_X);
+
+    // y of every row
+    array<float> row_y{};
+    ::resize(&row_y, row_count);
+
+    float y = 0;
+
+    for (u32 r = 0; r < row_count; ++r)
+    {
+        row_y.data[r] = y;
+        y += row_heights.data[r] + CFG_GAP_Y;
+    }
+
+    cfg->height = y;
+
+    for (s64 b = 0; b < count; ++b)
+    {
+        u32 r = rows.data[b];
+
+        // rows are centered
+        float offset = ((float)(widest_row - row_blocks.data[r]) * (CFG_BLOCK_WIDTH + CFG_GAP_X)) / 2.f;
+
+        cfg->block_x.data[b] = offset + cfg->block_x.data[b] * (CFG_BLOCK_WIDTH + CFG_GAP_X);
+        cfg->block_y.data[b] = row_y.data[r];
+    }
+
+    free(&rows);
+    free(&row_blocks);
+    free(&row_heights);
+    free(&row_y);
+
+    cfg->laid_out = true;
+}
@@ -0,0 +1,47 @@
+
+#pragma once
+
+// Control flow graph of a single function: the function's instructions split
+// into basic blocks, and the edges between them. Blocks end after the delay
+// slot of a branch or jump, or before an instruction something jumps to.
+// Built on demand, not at load, since most functions are never looked at.
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+
+struct function_cfg
+{
+    s64 function; // index into module_analysis.functions
+
+    // block i is all_instructions[block_starts[i] .. block_starts[i+1]],
+    // so there is one more entry than there are blocks.
+    s64 block_count;
+    array<u32> block_starts;
+
+    // successors of block i are edge_targets[edge_offsets[i] .. edge_offsets[i+1]]
+    array<u32> edge_offsets;
+    array<u32> edge_targets; // block indices
+
+    // layout, in characters (x) and lines (y) so it doesn't depend on the font.
+    // computed the first time the graph is displayed.
+    bool laid_out;
+    array<float> block_x;
+    array<float> block_y;
+    float width;
+    float height;
+};
+
+void init(function_cfg *cfg);
+void free(function_cfg *cfg);
+
+void build_function_cfg(const psp_disassembly *disasm, const module_analysis *analysis, s64 function, function_cfg *out);
+
+// width of every block, in characters
+#define CFG_BLOCK_WIDTH 48.f
+
+// layered layout: blocks are placed in rows by their distance from the entry
+void layout_function_cfg(function_cfg *cfg);
+
+// index of the block containing all_instructions[instruction_index], or -1
+s64 cfg_block_of(const function_cfg *cfg, s64 instruction_index);
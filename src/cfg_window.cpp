@@ -0,0 +1,268 @@
+
+#include "imgui.h"
+
+#include "shl/format.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "cfg.hpp"
+#include "cfg_window.hpp"
+#include "disassembly_window.hpp"
+#include "instruction_format.hpp"
+
+struct _cfg_window_data
+{
+    // built graphs, parallel to actx.analysis.functions, nullptr = not built yet
+    array<function_cfg*> cfgs;
+
+    u32 followed_address;
+    s64 function;
+};
+
+static _cfg_window_data *_cfg_data(bool _free = false)
+{
+    static _cfg_window_data *_data = nullptr;
+
+    if (_free)
+    {
+        if (_data != nullptr)
+        {
+            for_array(cfg, &_data->cfgs)
+            {
+                if (*cfg == nullptr)
+                    continue;
+
+                free(*cfg);
+                allocator_dealloc_T(actx.global_alloc, *cfg, function_cfg);
+            }
+
+            free(&_data->cfgs);
+            allocator_dealloc_T(actx.global_alloc, _data, _cfg_window_data);
+            _data = nullptr;
+        }
+
+        return nullptr;
+    }
+
+    if (_data == nullptr)
+    {
+        _data = allocator_alloc_T(actx.global_alloc, _cfg_window_data);
+        fill_memory(_data, 0);
+        _data->cfgs.allocator = actx.global_alloc;
+        _data->function = -1;
+    }
+
+    return _data;
+}
+
+void cfg_window_clear()
+{
+    _cfg_data(true);
+}
+
+// builds the graph of the function the first time it's requested
+static function_cfg *_get_cfg(_cfg_window_data *data, s64 function)
+{
+    const function_table *functions = &actx.analysis.functions;
+
+    if (data->cfgs.size != functions->count)
+    {
+        ::resize(&data->cfgs, functions->count);
+
+        for_array(cfg, &data->cfgs)
+            *cfg = nullptr;
+    }
+
+    function_cfg **cfg = data->cfgs.data + function;
+
+    if (*cfg == nullptr)
+    {
+        *cfg = allocator_alloc_T(actx.global_alloc, function_cfg);
+        init(*cfg);
+        (*cfg)->block_starts.allocator = actx.global_alloc;
+        (*cfg)->edge_offsets.allocator = actx.global_alloc;
+        (*cfg)->edge_targets.allocator = actx.global_alloc;
+        (*cfg)->block_x.allocator = actx.global_alloc;
+        (*cfg)->block_y.allocator = actx.global_alloc;
+
+        build_function_cfg(&actx.disasm, &actx.analysis, function, *cfg);
+    }
+
+    return *cfg;
+}
+
+static bool _overlaps(ImVec2 min1, ImVec2 max1, ImVec2 min2, ImVec2 max2)
+{
+    return min1.x <= max2.x && max1.x >= min2.x
+        && min1.y <= max2.y && max1.y >= min2.y;
+}
+
+static void _draw_graph(function_cfg *cfg)
+{
+    if (!cfg->laid_out)
+        layout_function_cfg(cfg);
+
+    const float char_width = actx.ui.fonts.mono->Glyphs['x'].AdvanceX;
+    const float line_height = actx.ui.fonts.mono->FontSize;
+
+    ImDrawList *draw = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+
+    // sets the scrollable area
+    ImGui::Dummy(ImVec2(cfg->width * char_width, cfg->height * line_height));
+
+    // visible area in screen space
+    ImVec2 view_min = ImGui::GetWindowPos();
+    ImVec2 view_max = ImVec2(view_min.x + ImGui::GetWindowSize().x, view_min.y + ImGui::GetWindowSize().y);
+
+    ImU32 text_color = ImGui::GetColorU32(ImGuiCol_Text);
+    ImU32 border_color = ImGui::GetColorU32(ImGuiCol_Border);
+    ImU32 block_color = ImGui::GetColorU32(ImGuiCol_FrameBg);
+    ImU32 edge_color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+    ImU32 back_edge_color = ImGui::GetColorU32(ImGuiCol_PlotLinesHovered);
+
+    const float block_width = CFG_BLOCK_WIDTH * char_width;
+
+    auto block_min = [cfg, origin, char_width, line_height](s64 b)
+    {
+        return ImVec2(origin.x + cfg->block_x.data[b] * char_width,
+                      origin.y + cfg->block_y.data[b] * line_height);
+    };
+
+    auto block_height = [cfg, line_height](s64 b)
+    {
+        return (float)(cfg->block_starts.data[b + 1] - cfg->block_starts.data[b] + 1) * line_height;
+    };
+
+    // edges, bottom center of a block to the top center of its successor
+    for (s64 b = 0; b < cfg->block_count; ++b)
+    for (u32 e = cfg->edge_offsets.data[b]; e < cfg->edge_offsets.data[b + 1]; ++e)
+    {
+        s64 t = cfg->edge_targets.data[e];
+        ImVec2 from = block_min(b);
+        from.x += block_width / 2;
+        from.y += block_height(b);
+
+        ImVec2 to = block_min(t);
+        to.x += block_width / 2;
+
+        ImVec2 min = ImVec2(Min(from.x, to.x), Min(from.y, to.y));
+        ImVec2 max = ImVec2(Max(from.x, to.x), Max(from.y, to.y));
+
+        if (!_overlaps(min, max, view_min, view_max))
+            continue;
+
+        ImU32 color = t <= b ? back_edge_color : edge_color;
+        draw->AddLine(from, to, color);
+        draw->AddTriangleFilled(ImVec2(to.x - 4, to.y - 8), ImVec2(to.x + 4, to.y - 8), to, color);
+    }
+
+    string line{};
+    line.allocator = actx.frame_alloc;
+
+    u32 clicked = max_value(u32);
+    ImVec2 mouse = ImGui::GetMousePos();
+    bool mouse_clicked = ImGui::IsWindowHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left);
+
+    // blocks, only the visible ones and only their visible lines
+    for (s64 b = 0; b < cfg->block_count; ++b)
+    {
+        ImVec2 min = block_min(b);
+        ImVec2 max = ImVec2(min.x + block_width, min.y + block_height(b));
+
+        if (!_overlaps(min, max, view_min, view_max))
+            continue;
+
+        draw->AddRectFilled(min, max, block_color);
+        draw->AddRect(min, max, border_color);
+        draw->PushClipRect(min, max, true);
+
+        s64 first = cfg->block_starts.data[b];
+        const char *label = instruction_label(first);
+
+        if (label[0] == '\0')
+            label = tformat("block %lld", (long long)b).c_str;
+
+        draw->AddText(min, text_color, label);
+
+        s64 count = cfg->block_starts.data[b + 1] - first;
+        s64 from_line = Max((s64)((view_min.y - min.y) / line_height) - 1, (s64)0);
+        s64 to_line = Min((s64)((view_max.y - min.y) / line_height) + 1, count);
+
+        for (s64 l = from_line; l < to_line; ++l)
+        {
+            instruction storage;
+            instruction *instr = instruction_at(first + l, &storage);
+            ImVec2 pos = ImVec2(min.x + char_width, min.y + (float)(l + 1) * line_height);
+
+            clear(&line);
+            format(&line, line.size, "%08x ", instr->address);
+            format_instruction(&line, instr, nullptr);
+
+            draw->AddText(pos, text_color, line.data, line.data + line.size);
+
+            if (mouse_clicked && mouse.y >= pos.y && mouse.y < pos.y + line_height
+             && mouse.x >= min.x && mouse.x < max.x)
+                clicked = instr->address;
+        }
+
+        draw->PopClipRect();
+    }
+
+    free(&line);
+
+    if (clicked != max_value(u32))
+        goto_address(clicked);
+}
+
+void cfg_window()
+{
+    if (module_analyzing())
+    {
+        if (ImGui::Begin("Control Flow Graph"))
+            ImGui::TextDisabled("Analyzing...");
+
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Begin("Control Flow Graph"))
+    {
+        _cfg_window_data *data = _cfg_data();
+        u32 current = disassembly_current_address();
+
+        // follow the disassembly, keep the last function while the
+        // disassembly is outside of any function.
+        if (current != data->followed_address)
+        {
+            data->followed_address = current;
+            s64 f = function_index_by_vaddr(current);
+
+            if (f >= 0)
+                data->function = f;
+        }
+
+        const function_table *functions = &actx.analysis.functions;
+
+        if (data->function < 0 || data->function >= functions->count)
+            ImGui::TextDisabled("no function at %08x", current);
+        else
+        {
+            function_cfg *cfg = _get_cfg(data, data->function);
+
+            ImGui::PushFont(actx.ui.fonts.mono);
+            ImGui::Text("%s, %lld blocks, %lld edges",
+                        address_label(functions->starts[data->function]),
+                        (long long)cfg->block_count, (long long)cfg->edge_targets.size);
+
+            if (ImGui::BeginChild("##graph", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar))
+                _draw_graph(cfg);
+
+            ImGui::EndChild();
+            ImGui::PopFont();
+        }
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,8 @@
+
+#pragma once
+
+// control flow graph of the function at the current disassembly address
+void cfg_window();
+
+// drops all built graphs and layouts, call when the module changes
+void cfg_window_clear();
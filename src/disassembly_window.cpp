@@ -6,6 +6,7 @@
 #include "allegrexplorer_context.hpp" // address_name / address_label
 #include "allegrexplorer_settings.hpp"
 #include "disassembly_window.hpp"
+#include "instruction_format.hpp"
 
 struct _disassembly_goto_jump
 {
@@ -58,182 +59,142 @@ static _disassembly_goto_jump *disasm_jump_data(bool _free = false)
     return _disasm_jump;
 }
 
-void format_instruction(string *out, instruction *instr, jump_destination *out_jump = nullptr)
+// formatted lines of the most recently displayed instructions, so lines
+// that stay on screen aren't formatted again every frame.
+#define DISASM_LINE_CACHE_SIZE 4096 // power of two
+
+struct _disassembly_line
 {
-    // format instruction mnemonic
-    const char *instr_name = get_mnemonic_name(instr->mnemonic);
+    s64 instruction_index; // -1 = unused
+    string text;
 
-    if (requires_vfpu_suffix(instr->mnemonic))
-    {
-        vfpu_size sz = get_vfpu_size(instr->opcode);
-        const char *suf = size_suffix(sz);
-        auto fullname = tformat("%%"_cs, instr_name, suf);
+    u32 jump_address; // max_value(u32) = no jump
+    const char *jump_label; // interned, lives as long as the module
+};
 
-        format(out, out->size, "%-10s", fullname);
-    }
-    else
-        format(out, out->size, "%-10s", instr_name);
+struct _disassembly_line_cache
+{
+    // display settings the lines were formatted with
+    bool show_instruction_elf_offset;
+    bool show_instruction_vaddr;
+    bool show_instruction_opcode;
+
+    _disassembly_line lines[DISASM_LINE_CACHE_SIZE];
+};
+
+static void init(_disassembly_line_cache *cache)
+{
+    fill_memory(cache, 0);
 
-    // format instruction arguments
-    bool first_arg = true;
-    for (u32 i = 0; i < instr->argument_count; ++i)
+    for (s64 i = 0; i < DISASM_LINE_CACHE_SIZE; ++i)
     {
-        instruction_argument *arg = instr->arguments + i;
-        argument_type arg_type = instr->argument_types[i];
+        cache->lines[i].instruction_index = -1;
+        cache->lines[i].text.allocator = actx.global_alloc;
+    }
+}
 
-        if (!first_arg && arg_type != argument_type::Base_Register)
-            format(out, out->size, ", ");
+static void free(_disassembly_line_cache *cache)
+{
+    for (s64 i = 0; i < DISASM_LINE_CACHE_SIZE; ++i)
+        free(&cache->lines[i].text);
+}
 
-        first_arg = false;
+static _disassembly_line_cache *disasm_line_cache(bool _free = false)
+{
+    static _disassembly_line_cache *_cache = nullptr;
 
-        switch (arg_type)
+    if (_free)
+    {
+        if (_cache != nullptr)
         {
-        case argument_type::Invalid:
-            format(out, out->size, "[?invalid?]");
-            break;
+            free(_cache);
+            allocator_dealloc_T(actx.global_alloc, _cache, _disassembly_line_cache);
+            _cache = nullptr;
+        }
 
-        case argument_type::MIPS_Register:
-            format(out, out->size, "%s", register_name(arg->mips_register));
-            break;
+        return nullptr;
+    }
 
-        case argument_type::MIPS_FPU_Register:
-            format(out, out->size, "%s", register_name(arg->mips_fpu_register));
-            break;
+    if (_cache == nullptr)
+    {
+        _cache = allocator_alloc_T(actx.global_alloc, _disassembly_line_cache);
+        init(_cache);
+    }
 
-        case argument_type::VFPU_Register:
-            format(out, out->size, "%s", register_name(arg->vfpu_register));
-            break;
+    return _cache;
+}
 
-        case argument_type::VFPU_Matrix:
-            format(out, out->size, "%s%s", matrix_name(arg->vfpu_matrix)
-                                           , size_suffix(arg->vfpu_matrix.size));
-            break;
+static void _invalidate_lines(_disassembly_line_cache *cache)
+{
+    for (s64 i = 0; i < DISASM_LINE_CACHE_SIZE; ++i)
+        cache->lines[i].instruction_index = -1;
+}
 
-        case argument_type::VFPU_Condition:
-            format(out, out->size, "%s", vfpu_condition_name(arg->vfpu_condition));
-            break;
+static _disassembly_line *_get_line(_disassembly_line_cache *cache, s64 index)
+{
+    _disassembly_line *ln = cache->lines + (index & (DISASM_LINE_CACHE_SIZE - 1));
 
-        case argument_type::VFPU_Constant:
-            format(out, out->size, "%s", vfpu_constant_name(arg->vfpu_constant));
-            break;
+    if (ln->instruction_index == index)
+        return ln;
 
-        case argument_type::VFPU_Prefix_Array:
-        {
-            vfpu_prefix_array *arr = &arg->vfpu_prefix_array;
-            format(out, out->size, "[%s,%s,%s,%s]", vfpu_prefix_name(arr->data[0])
-                                       , vfpu_prefix_name(arr->data[1])
-                                       , vfpu_prefix_name(arr->data[2])
-                                       , vfpu_prefix_name(arr->data[3])
-            );
-            break;
-        }
+    instruction storage;
+    instruction *instr = instruction_at(index, &storage);
+    string *line = &ln->text;
 
-        case argument_type::VFPU_Destination_Prefix_Array:
-        {
-            vfpu_destination_prefix_array *arr = &arg->vfpu_destination_prefix_array;
-            format(out, out->size, "[%s,%s,%s,%s]"
-                                   , vfpu_destination_prefix_name(arr->data[0])
-                                   , vfpu_destination_prefix_name(arr->data[1])
-                                   , vfpu_destination_prefix_name(arr->data[2])
-                                   , vfpu_destination_prefix_name(arr->data[3])
-            );
-            break;
-        }
+    clear(line);
 
-        case argument_type::VFPU_Rotation_Array:
-        {
-            vfpu_rotation_array *arr = &arg->vfpu_rotation_array;
-            format(out, out->size, "[%s", vfpu_rotation_name(arr->data[0]));
+    if (cache->show_instruction_elf_offset)
+        format(line, line->size, "%08x ", instruction_elf_offset(index));
 
-            for (u32 j = 1; j < arr->size; ++j)
-                format(out, out->size, ",%s", vfpu_rotation_name(arr->data[j]));
+    if (cache->show_instruction_vaddr)
+        format(line, line->size, "%08x ", instr->address);
 
-            format(out, out->size, "]");
-            break;
-        }
+    if (cache->show_instruction_opcode)
+        format(line, line->size, "%08x ", instr->opcode);
 
-        case argument_type::PSP_Function_Pointer:
-        {
-            const psp_function *sc = arg->psp_function_pointer;
-            format(out, out->size, "%s <0x%08x>", sc->name, sc->nid);
-            break;
-        }
+    format(line, line->size, "%-32s ", instruction_label(index));
 
-#define ARG_TYPE_FORMAT(out, arg, ArgumentType, UnionMember, FMT) \
-case argument_type::ArgumentType: \
-    format(out, out->size, FMT, arg->UnionMember.data);\
-    break;
+    jump_destination jmp{};
+    jmp.address = max_value(u32);
 
-        ARG_TYPE_FORMAT(out, arg, Shift, shift, "%#x");
+    format_instruction(line, instr, &jmp);
 
-        case argument_type::Coprocessor_Register:
-        {
-            coprocessor_register *reg = &arg->coprocessor_register;
-            format(out, out->size, "[%u, %u]", reg->rd, reg->sel);
-            break;
-        }
+    ln->jump_address = jmp.address;
+    ln->jump_label = nullptr;
 
-        case argument_type::Base_Register:
-            format(out, out->size, "(%s)", register_name(arg->base_register.data));
-            break;
+    if (jmp.address != max_value(u32))
+        ln->jump_label = address_label(jmp.address);
 
-        case argument_type::Jump_Address:
-            if (out_jump != nullptr)
-                *out_jump = jump_destination{arg->jump_address.data, jump_type::Jump};
-            else
-                format(out, out->size, "%s", address_name(arg->jump_address.data));
-            break;
+    ln->instruction_index = index;
 
-        case argument_type::Branch_Address:
-            if (out_jump != nullptr)
-                *out_jump = jump_destination{arg->branch_address.data, jump_type::Branch};
-            else
-                format(out, out->size, "%s", address_name(arg->branch_address.data));
-            break;
-
-        case argument_type::Memory_Offset:
-            format(out, out->size, "%#x", (u32)arg->memory_offset.data);
-            break;
-        ARG_TYPE_FORMAT(out, arg, Immediate_u32, immediate_u32, "%#x");
-        case argument_type::Immediate_s32:
-        {
-            s32 d = arg->immediate_s32.data;
-
-            if (d < 0)
-                format(out, out->size, "-%#x", -d);
-            else
-                format(out, out->size, "%#x", d);
-
-            break;
-        }
+    return ln;
+}
 
-        ARG_TYPE_FORMAT(out, arg, Immediate_u16, immediate_u16, "%#x");
-        case argument_type::Immediate_s16:
-        {
-            s16 d = arg->immediate_s16.data;
+#define XREF_TOOLTIP_MAX_ROWS 10
 
-            if (d < 0)
-                format(out, out->size, "-%#x", -d);
-            else
-                format(out, out->size, "%#x", d);
+static void _xrefs_tooltip(u32 addr)
+{
+    if (module_analyzing())
+    {
+        // the xref index isn't there yet
+        ImGui::Text("%08x", addr);
+        ImGui::TextDisabled("Analyzing...");
+        return;
+    }
 
-            break;
-        }
+    xref_range xrefs = xrefs_to(&actx.analysis.xrefs, addr);
 
-        ARG_TYPE_FORMAT(out, arg, Immediate_u8,    immediate_u8,    "%#x");
-        ARG_TYPE_FORMAT(out, arg, Immediate_float, immediate_float, "%f");
-        ARG_TYPE_FORMAT(out, arg, Condition_Code,  condition_code,  "(CC[%#x])");
-        ARG_TYPE_FORMAT(out, arg, Bitfield_Pos,    bitfield_pos,    "%#x");
-        ARG_TYPE_FORMAT(out, arg, Bitfield_Size,   bitfield_size,   "%#x");
+    ImGui::Text("%08x, %lld xrefs", addr, (long long)xrefs.count);
 
-        ARG_TYPE_FORMAT(out, arg, String, string_argument, "%s");
+    for (s64 i = 0; i < Min(xrefs.count, (s64)XREF_TOOLTIP_MAX_ROWS); ++i)
+    {
+        u32 src = actx.analysis.instructions.addresses[xrefs.sources[i]];
 
-        case argument_type::Extra:
-        case argument_type::MAX:
-        default:
-            break;
-        }
+        ImGui::Text("%08x %-7s %s", src, xref_type_name(xrefs.types[i]), function_offset_label(src));
     }
+
+    if (xrefs.count > XREF_TOOLTIP_MAX_ROWS)
+        ImGui::TextDisabled("... %lld more", (long long)(xrefs.count - XREF_TOOLTIP_MAX_ROWS));
 }
 
 void disassembly_window()
@@ -252,7 +213,7 @@ void disassembly_window()
         const float line_height  = font_height + style->ItemSpacing.y;
 
         const float computed_disassembly_height = start_height
-            + line_height * (actx.disasm.all_instructions.size)
+            + line_height * instruction_count()
             + font_height;
 
         // Set height upfront, so scrollbars are accurate
@@ -290,8 +251,8 @@ void disassembly_window()
         s64 from_instr = (s64)((from_y - (start_height + font_height)) / line_height) - 4;
         s64 to_instr   = (s64)((to_y   - (start_height + font_height)) / line_height) + 4;
 
-        from_instr = Clamp(from_instr, (s64)0, actx.disasm.all_instructions.size);
-        to_instr   = Clamp(to_instr,   (s64)0, actx.disasm.all_instructions.size);
+        from_instr = Clamp(from_instr, (s64)0, instruction_count());
+        to_instr   = Clamp(to_instr,   (s64)0, instruction_count());
 
         ImGui::Text("%s%s%s%-32s",
                 settings->disassembly.show_instruction_elf_offset ? "Offset   " : "",
@@ -299,51 +260,43 @@ void disassembly_window()
                 settings->disassembly.show_instruction_opcode     ? "Opcode   " : "",
                 "Name/Symbol");
 
-        string line{};
+        _disassembly_line_cache *cache = disasm_line_cache();
 
-        array<instruction> *all_instructions = &actx.disasm.all_instructions;
+        if (cache->show_instruction_elf_offset != settings->disassembly.show_instruction_elf_offset
+         || cache->show_instruction_vaddr      != settings->disassembly.show_instruction_vaddr
+         || cache->show_instruction_opcode     != settings->disassembly.show_instruction_opcode)
+        {
+            cache->show_instruction_elf_offset = settings->disassembly.show_instruction_elf_offset;
+            cache->show_instruction_vaddr  = settings->disassembly.show_instruction_vaddr;
+            cache->show_instruction_opcode = settings->disassembly.show_instruction_opcode;
+            _invalidate_lines(cache);
+        }
 
         for (s64 i = from_instr; i < to_instr; ++i)
         {
-            instruction *instr = all_instructions->data + i;
+            _disassembly_line *ln = _get_line(cache, i);
             ImGui::PushID((int)i);
 
-            clear(&line);
-
-            //if (settings->disassembly.show_instruction_elf_offset)
-            //    format(&line, line.size, "%08x ", (u32)dsec->section->content_offset + i * (u32)sizeof(u32));
-
-            if (settings->disassembly.show_instruction_vaddr)
-                format(&line, line.size, "%08x ", instr->address);
-
-            if (settings->disassembly.show_instruction_opcode)
-                format(&line, line.size, "%08x ", instr->opcode);
-
-            format(&line, line.size, "%-32s ", address_label(instr->address));
-
-            jump_destination jmp{};
-            jmp.address = max_value(u32);
-
-            format_instruction(&line, instr, &jmp);
-
             ImGui::SetCursorPosY(start_height + font_height + line_height * (i+1));
-            ImGui::Text("%s", line.data);
+            ImGui::TextUnformatted(ln->text.data, ln->text.data + ln->text.size);
 
-            if (jmp.address != max_value(u32))
+            if (ln->jump_address != max_value(u32))
             {
                 ImGui::SameLine(0, 0);
 
-                if (ImGui::SmallButton(address_label(jmp.address)))
-                    disassembly_goto_address(jmp.address);
+                if (ImGui::SmallButton(ln->jump_label))
+                    disassembly_goto_address(ln->jump_address);
 
-                ImGui::SetItemTooltip("%08x", jmp.address);
+                if (ImGui::BeginItemTooltip())
+                {
+                    _xrefs_tooltip(ln->jump_address);
+                    ImGui::EndTooltip();
+                }
             }
 
             ImGui::PopID();
         }
 
-        free(&line);
-
         // break;
     }
 
@@ -359,6 +312,11 @@ void disassembly_goto_address(u32 addr)
     disasm_jump->is_history_back_jump = false;
 }
 
+u32 disassembly_current_address()
+{
+    return disasm_jump_data()->address;
+}
+
 float disassembly_instruction_index_to_offset(s64 index)
 {
     ImGuiStyle *style  = &ImGui::GetStyle();
@@ -380,7 +338,7 @@ s64   disassembly_offset_to_instruction_index(float offset)
     const float line_height  = font_height + style->ItemSpacing.y;
     
     s64 ret = (s64)((offset - (start_height + font_height)) / line_height) + 1;
-    ret = Clamp(ret, (s64)0, actx.disasm.all_instructions.size - 1);
+    ret = Clamp(ret, (s64)0, instruction_count() - 1);
 
     return ret;
 }
@@ -397,15 +355,15 @@ float disassembly_address_to_offset(u32 address)
 
 u32   disassembly_offset_to_address(float offset)
 {
-    instruction *instrs = actx.disasm.all_instructions.data;
-    s64 instr_count = actx.disasm.all_instructions.size;
+    const u32 *addresses = actx.analysis.instructions.addresses.data;
+    s64 instr_count = instruction_count();
     
     s64 idx = disassembly_offset_to_instruction_index(offset);
 
     if (idx < 0 || idx >= instr_count)
         return max_value(u32);
 
-    return instrs[idx].address;
+    return addresses[idx];
 }
 
 bool disassembly_history_can_go_back()
@@ -455,3 +413,8 @@ void disassembly_history_clear()
 {
     disasm_jump_data(true);
 }
+
+void disassembly_line_cache_clear()
+{
+    disasm_line_cache(true);
+}
@@ -6,6 +6,8 @@
 void disassembly_window();
 
 void disassembly_goto_address(u32 addr);
+// address of the last goto, 0 if there was none
+u32  disassembly_current_address();
 
 // vertical offset
 float disassembly_instruction_index_to_offset(s64 index);
@@ -18,3 +20,6 @@ bool disassembly_history_can_go_forward();
 void disassembly_history_go_back();
 void disassembly_history_go_forward();
 void disassembly_history_clear();
+
+// drops all cached formatted lines, call when the module or names change
+void disassembly_line_cache_clear();
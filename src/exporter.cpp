@@ -0,0 +1,142 @@
+
+#include "shl/defer.hpp"
+#include "shl/format.hpp"
+#include "shl/io.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "allegrex/disassemble.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "instruction_format.hpp"
+#include "exporter.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+#include "timer.hpp"
+
+// how many chunks are formatted before they're written out together
+#define EXPORT_BATCH_CHUNKS 64
+
+static void _format_section_header(string *out, s64 section_index)
+{
+    format(out, out->size, "\n// section %s\n", actx.disasm.disassembly_sections[section_index].section->name);
+}
+
+static void _format_chunk(s64 chunk_index, string *out)
+{
+    module_analysis *analysis = &actx.analysis;
+    analysis_chunk *chunk = analysis->chunks.data + chunk_index;
+
+    clear(out);
+
+    // headers of this chunks section and of any empty sections before it
+    if (chunk->from == analysis->section_offsets[chunk->section_index])
+    {
+        s64 prev_section = chunk_index > 0 ? analysis->chunks[chunk_index - 1].section_index : -1;
+
+        for (s64 sec_i = prev_section + 1; sec_i <= chunk->section_index; ++sec_i)
+            _format_section_header(out, sec_i);
+    }
+
+    auto *dsec = actx.disasm.disassembly_sections.data + chunk->section_index;
+    s64 first_instr = analysis->section_offsets[chunk->section_index];
+    instruction storage;
+
+    for (s64 idx = chunk->from; idx < chunk->to; ++idx)
+    {
+        s64 i = idx - first_instr;
+        instruction *instr = instruction_at(idx, &storage);
+
+        format(out, out->size, "/* %08x %08x %08x %-32s */ ",
+                (u32)dsec->section->content_offset + i * (u32)sizeof(u32),
+                instr->address,
+                instr->opcode,
+                instruction_label(idx));
+
+        format_instruction(out, instr, nullptr);
+
+        format(out, out->size, "\n");
+    }
+}
+
+bool export_disassembly(const char *path, export_stats *stats, error *err)
+{
+    profile_scope("export disassembly");
+    u64 start = time_now_ns();
+    fill_memory(stats, 0);
+
+    io_handle f = io_open(path, open_mode::WriteTrunc, err);
+
+    if (f == INVALID_IO_HANDLE)
+        return false;
+
+    defer { io_close(f); };
+
+    string buffers[EXPORT_BATCH_CHUNKS]{};
+
+    for (s64 j = 0; j < EXPORT_BATCH_CHUNKS; ++j)
+        buffers[j].allocator = actx.global_alloc;
+
+    defer
+    {
+        for (s64 j = 0; j < EXPORT_BATCH_CHUNKS; ++j)
+            free(buffers + j);
+    };
+
+    module_analysis *analysis = &actx.analysis;
+    s64 chunk_count = analysis->chunks.size;
+
+    for (s64 batch = 0; batch < chunk_count; batch += EXPORT_BATCH_CHUNKS)
+    {
+        s64 batch_size = Min((s64)EXPORT_BATCH_CHUNKS, chunk_count - batch);
+
+        parallel_for(actx.workers, batch_size, [batch, &buffers](s64 j)
+        {
+            _format_chunk(batch + j, buffers + j);
+        });
+
+        for (s64 j = 0; j < batch_size; ++j)
+        {
+            if (io_write(f, buffers[j].data, buffers[j].size, err) < 0)
+                return false;
+
+            stats->bytes += buffers[j].size;
+            stats->lines += analysis->chunks[batch + j].to - analysis->chunks[batch + j].from;
+        }
+    }
+
+    // trailing sections without instructions
+    s64 last_section = chunk_count > 0 ? analysis->chunks[chunk_count - 1].section_index : -1;
+    string *tail = buffers;
+    clear(tail);
+
+    for (s64 sec_i = last_section + 1; sec_i < actx.disasm.disassembly_sections.size; ++sec_i)
+        _format_section_header(tail, sec_i);
+
+    if (tail->size > 0)
+    {
+        if (io_write(f, tail->data, tail->size, err) < 0)
+            return false;
+
+        stats->bytes += tail->size;
+    }
+
+    stats->duration_ns = time_now_ns() - start;
+
+    return true;
+}
+
+bool export_decrypted_elf(const char *path, error *err)
+{
+    io_handle f = io_open(path, open_mode::WriteTrunc, err);
+
+    if (f == INVALID_IO_HANDLE)
+        return false;
+
+    defer { io_close(f); };
+
+    s64 size = 0;
+    const char *data = module_elf_data(&size);
+
+    return io_write(f, data, size, err) >= 0;
+}
@@ -0,0 +1,22 @@
+
+#pragma once
+
+// Exporting of the currently loaded module, used by the export popups
+// and by the headless command line mode.
+
+#include "shl/error.hpp"
+#include "shl/number_types.hpp"
+
+struct export_stats
+{
+    s64 bytes;
+    s64 lines;
+    u64 duration_ns;
+};
+
+// writes the disassembly of all sections of actx.disasm to path as text.
+// chunks are formatted in parallel on actx.workers and written in order.
+bool export_disassembly(const char *path, export_stats *stats, error *err);
+
+// writes the (decrypted) elf of actx.disasm to path
+bool export_decrypted_elf(const char *path, error *err);
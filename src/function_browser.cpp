@@ -0,0 +1,257 @@
+
+#include "imgui.h"
+
+#include "shl/compare.hpp"
+#include "shl/format.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "function_browser.hpp"
+
+enum _function_column
+{
+    Column_Address,
+    Column_Name,
+    Column_Size,
+    Column_Instructions,
+    Column_Callers,
+    Column_Callees,
+    Column_Leaf
+};
+
+struct _function_browser
+{
+    char filter[256];
+
+    // indices into actx.analysis.functions, filtered and sorted
+    array<u32> rows;
+    bool rows_dirty;
+
+    // label of every function, by function index. resolved once, since
+    // sorting and filtering look at every name.
+    array<const char*> names;
+};
+
+static _function_browser *_browser_data(bool _free = false)
+{
+    static _function_browser *_browser = nullptr;
+
+    if (_free)
+    {
+        if (_browser != nullptr)
+        {
+            free(&_browser->rows);
+            free(&_browser->names);
+            allocator_dealloc_T(actx.global_alloc, _browser, _function_browser);
+            _browser = nullptr;
+        }
+
+        return nullptr;
+    }
+
+    if (_browser == nullptr)
+    {
+        _browser = allocator_alloc_T(actx.global_alloc, _function_browser);
+        fill_memory(_browser, 0);
+        _browser->rows.allocator = actx.global_alloc;
+        _browser->names.allocator = actx.global_alloc;
+        _browser->rows_dirty = true;
+    }
+
+    return _browser;
+}
+
+void function_browser_clear()
+{
+    _browser_data(true);
+}
+
+// compare functions take no context, so the column, direction and names being
+// sorted by are passed through here.
+static _function_column _sort_column = Column_Address;
+static bool _sort_descending = false;
+static const char **_sort_names = nullptr;
+
+static u32 _column_value(const function_table *functions, u32 f, _function_column column)
+{
+    switch (column)
+    {
+    case Column_Size:         return functions->ends.data[f] - functions->starts.data[f];
+    case Column_Instructions: return functions->instruction_counts.data[f];
+    case Column_Callers:      return functions->caller_counts.data[f];
+    case Column_Callees:      return functions->callee_counts.data[f];
+    case Column_Leaf:         return functions->leafs.data[f] ? 1 : 0;
+    default:                  return functions->starts.data[f];
+    }
+}
+
+static int _compare_rows(const u32 *l, const u32 *r)
+{
+    const function_table *functions = &actx.analysis.functions;
+    int c = 0;
+
+    if (_sort_column == Column_Name)
+        c = string_compare(_sort_names[*l], _sort_names[*r]);
+    else
+        c = compare_ascending(_column_value(functions, *l, _sort_column),
+                              _column_value(functions, *r, _sort_column));
+
+    if (_sort_descending)
+        c = -c;
+
+    // functions are sorted by address, keeps the order stable
+    return c != 0 ? c : compare_ascending(*l, *r);
+}
+
+static char _lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// case-insensitive substring match
+static bool _passes_filter(const char *name, const char *filter)
+{
+    if (filter[0] == '\0')
+        return true;
+
+    for (; *name != '\0'; ++name)
+    {
+        s64 i = 0;
+
+        while (filter[i] != '\0' && _lower(name[i]) == _lower(filter[i]))
+            ++i;
+
+        if (filter[i] == '\0')
+            return true;
+    }
+
+    return false;
+}
+
+static void _build_rows(_function_browser *browser)
+{
+    const function_table *functions = &actx.analysis.functions;
+
+    if (browser->names.size != functions->count)
+    {
+        ::resize(&browser->names, functions->count);
+
+        for (s64 f = 0; f < functions->count; ++f)
+            browser->names.data[f] = address_label(functions->starts.data[f]);
+    }
+
+    clear(&browser->rows);
+
+    for (s64 f = 0; f < functions->count; ++f)
+        if (_passes_filter(browser->names.data[f], browser->filter))
+            ::add_at_end(&browser->rows, (u32)f);
+
+    _sort_names = browser->names.data;
+    ::sort(browser->rows.data, browser->rows.size, _compare_rows);
+}
+
+void function_browser_window()
+{
+    if (module_analyzing())
+    {
+        if (ImGui::Begin("Function Browser"))
+            ImGui::TextDisabled("Analyzing...");
+
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Begin("Function Browser"))
+    {
+        _function_browser *browser = _browser_data();
+        const function_table *functions = &actx.analysis.functions;
+
+        if (ImGui::InputText("Filter", browser->filter, 255))
+            browser->rows_dirty = true;
+
+        ImGui::SameLine();
+        ImGui::TextDisabled("%lld / %lld", (long long)browser->rows.size, (long long)functions->count);
+
+        ImGui::PushFont(actx.ui.fonts.mono);
+
+        ImGuiTableFlags flags = ImGuiTableFlags_Sortable
+                              | ImGuiTableFlags_Resizable
+                              | ImGuiTableFlags_RowBg
+                              | ImGuiTableFlags_BordersOuter
+                              | ImGuiTableFlags_ScrollY;
+
+        if (ImGui::BeginTable("##functions", 7, flags))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Address",      ImGuiTableColumnFlags_DefaultSort, 0.f, Column_Address);
+            ImGui::TableSetupColumn("Name",         ImGuiTableColumnFlags_WidthStretch, 0.f, Column_Name);
+            ImGui::TableSetupColumn("Size",         ImGuiTableColumnFlags_PreferSortDescending, 0.f, Column_Size);
+            ImGui::TableSetupColumn("Instructions", ImGuiTableColumnFlags_PreferSortDescending, 0.f, Column_Instructions);
+            ImGui::TableSetupColumn("Callers",      ImGuiTableColumnFlags_PreferSortDescending, 0.f, Column_Callers);
+            ImGui::TableSetupColumn("Callees",      ImGuiTableColumnFlags_PreferSortDescending, 0.f, Column_Callees);
+            ImGui::TableSetupColumn("Leaf",         0, 0.f, Column_Leaf);
+            ImGui::TableHeadersRow();
+
+            ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs();
+
+            if (specs != nullptr && specs->SpecsDirty && specs->SpecsCount > 0)
+            {
+                _sort_column = (_function_column)specs->Specs[0].ColumnUserID;
+                _sort_descending = specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+                specs->SpecsDirty = false;
+                browser->rows_dirty = true;
+            }
+
+            if (browser->rows_dirty)
+            {
+                _build_rows(browser);
+                browser->rows_dirty = false;
+            }
+
+            u32 clicked = max_value(u32);
+
+            ImGuiListClipper clipper;
+            clipper.Begin((int)browser->rows.size);
+
+            while (clipper.Step())
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+            {
+                u32 f = browser->rows[row];
+                u32 start = functions->starts.data[f];
+
+                ImGui::TableNextRow();
+                ImGui::PushID(row);
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Selectable(tformat("%08x", start).c_str, false, ImGuiSelectableFlags_SpanAllColumns))
+                    clicked = start;
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(browser->names.data[f]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", functions->ends.data[f] - start);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", functions->instruction_counts.data[f]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", functions->caller_counts.data[f]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", functions->callee_counts.data[f]);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(functions->leafs.data[f] ? "yes" : "");
+
+                ImGui::PopID();
+            }
+
+            ImGui::EndTable();
+
+            if (clicked != max_value(u32))
+                goto_address(clicked);
+        }
+
+        ImGui::PopFont();
+    }
+
+    ImGui::End();
+}
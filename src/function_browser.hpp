@@ -0,0 +1,8 @@
+
+#pragma once
+
+// sortable, filterable list of all functions of the loaded module
+void function_browser_window();
+
+// releases the state of the window, e.g. when a module is unloaded
+void function_browser_clear();
@@ -0,0 +1,143 @@
+
+#include <atomic>
+
+#include "shl/memory.hpp"
+
+#include "analysis.hpp"
+#include "functions.hpp"
+#include "thread_pool.hpp"
+
+void init(function_table *functions)
+{
+    fill_memory(functions, 0);
+}
+
+void free(function_table *functions)
+{
+    free(&functions->starts);
+    free(&functions->ends);
+    free(&functions->first_instructions);
+    free(&functions->instruction_counts);
+    free(&functions->caller_counts);
+    free(&functions->callee_counts);
+    free(&functions->leafs);
+    functions->count = 0;
+}
+
+// index of the last function starting at or before vaddr, or -1
+static s64 _last_function_before(const function_table *functions, u32 vaddr)
+{
+    s64 lo = 0;
+    s64 hi = functions->count;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (functions->starts.data[mid] <= vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo - 1;
+}
+
+s64 function_index_at(const function_table *functions, u32 vaddr)
+{
+    s64 f = _last_function_before(functions, vaddr);
+
+    if (f < 0 || functions->starts.data[f] != vaddr)
+        return -1;
+
+    return f;
+}
+
+s64 function_index_containing(const function_table *functions, u32 vaddr)
+{
+    s64 f = _last_function_before(functions, vaddr);
+
+    if (f < 0 || vaddr >= functions->ends.data[f])
+        return -1;
+
+    return f;
+}
+
+void build_function_table(psp_disassembly *disasm, module_analysis *analysis, function_table *out, thread_pool *pool)
+{
+    // all_jumps is sorted by address
+    u32 last_address = max_value(u32);
+
+    for_array(jmp, &disasm->all_jumps)
+    {
+        if (jmp->type != jump_type::Jump || jmp->address == last_address)
+            continue;
+
+        s64 index = analysis_instruction_index(analysis, disasm, jmp->address);
+
+        if (index < 0)
+            continue;
+
+        last_address = jmp->address;
+        ::add_at_end(&out->starts, jmp->address);
+        ::add_at_end(&out->first_instructions, index);
+    }
+
+    s64 count = out->starts.size;
+    out->count = count;
+
+    ::resize(&out->ends, count);
+    ::resize(&out->instruction_counts, count);
+    ::resize(&out->caller_counts, count);
+    ::resize(&out->callee_counts, count);
+    ::resize(&out->leafs, count);
+
+    for (s64 f = 0; f < count; ++f)
+    {
+        const section_range *range = analysis_section_range(analysis, out->starts.data[f]);
+        u32 end = range->vaddr_end;
+
+        if (f + 1 < count && out->starts.data[f + 1] < end)
+            end = out->starts.data[f + 1];
+
+        out->ends.data[f] = end;
+        out->instruction_counts.data[f] = (end - out->starts.data[f]) / sizeof(u32);
+        out->caller_counts.data[f] = 0;
+    }
+
+    parallel_for(pool, count, [analysis, out](s64 f)
+    {
+        s64 first = out->first_instructions.data[f];
+        s64 last = first + out->instruction_counts.data[f];
+        u32 callees = 0;
+        bool leaf = true;
+
+        for (s64 i = first; i < last; ++i)
+        {
+            u8 flags = analysis->instructions.flags.data[i];
+            u32 target = analysis->jump_targets.data[i];
+            s64 callee = target != max_value(u32) ? function_index_at(out, target) : -1;
+
+            if (flags & Instruction_Call)
+            {
+                // jalr has no target we know of, but it's still a call
+                leaf = false;
+                callees += 1;
+            }
+            else if ((flags & Instruction_Jump) && callee >= 0 && callee != f)
+            {
+                // a j to the start of another function is a tail call,
+                // one to our own start and branches to any start are loops.
+                callees += 1;
+            }
+            else
+                continue;
+
+            if (callee >= 0)
+                std::atomic_ref<u32>(out->caller_counts.data[callee]).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        out->callee_counts.data[f] = callees;
+        out->leafs.data[f] = leaf;
+    });
+}
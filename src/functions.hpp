@@ -0,0 +1,41 @@
+
+#pragma once
+
+// Boundaries and call statistics of every function of a module, built once
+// at load. Functions are the targets of jumps (jal / j) that were
+// disassembled, a function ends where the next one or its section starts.
+// Stored as parallel arrays, indexed by function, sorted by start address.
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+struct thread_pool;
+
+struct function_table
+{
+    s64 count;
+
+    array<u32> starts;             // vaddr of the first instruction
+    array<u32> ends;               // vaddr after the last instruction
+    array<s64> first_instructions; // index into all_instructions
+    array<u32> instruction_counts;
+
+    // call sites, i.e. calls (jal, jalr, bal, ...) and tail calls (j to the
+    // start of another function), so two calls from one function to another
+    // count as two. callers only count calls with a known target.
+    array<u32> caller_counts;      // calls to this function
+    array<u32> callee_counts;      // calls made by this function, including tail calls
+
+    array<bool> leafs;             // makes no calls
+};
+
+void init(function_table *functions);
+void free(function_table *functions);
+
+// analysis must have its jump targets built already
+void build_function_table(psp_disassembly *disasm, module_analysis *analysis, function_table *out, thread_pool *pool);
+
+// index of the function starting at vaddr, or -1
+s64 function_index_at(const function_table *functions, u32 vaddr);
+// index of the function containing vaddr, or -1
+s64 function_index_containing(const function_table *functions, u32 vaddr);
@@ -0,0 +1,14 @@
+
+#pragma once
+
+// Text formatting of disassembled instructions, shared by the disassembly
+// window and the exporter. Doesn't depend on ImGui.
+
+#include "shl/string.hpp"
+#include "allegrex/disassemble.hpp"
+
+// appends the mnemonic and arguments of instr to out.
+// if out_jump is not null, jump and branch targets are not formatted and
+// are written to out_jump instead.
+// safe to call from multiple threads at once.
+void format_instruction(string *out, instruction *instr, jump_destination *out_jump = nullptr);
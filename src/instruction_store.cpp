@@ -0,0 +1,134 @@
+
+#include "shl/memory.hpp"
+
+#include "analysis.hpp"
+#include "instruction_store.hpp"
+#include "instruction_tables.hpp"
+#include "thread_pool.hpp"
+
+#define INSTRUCTION_MAX_ARGUMENTS (s64)(sizeof(instruction::arguments) / sizeof(instruction_argument))
+
+void init(instruction_store *store)
+{
+    fill_memory(store, 0);
+}
+
+void free(instruction_store *store)
+{
+    free(&store->offsets);
+    free(&store->data);
+}
+
+// number of bytes of arg up to and including the last non-zero byte
+static inline u8 _argument_length(const instruction_argument *arg)
+{
+    const u8 *bytes = (const u8*)arg;
+    s64 len = (s64)sizeof(instruction_argument);
+
+    while (len > 0 && bytes[len - 1] == 0)
+        len -= 1;
+
+    return (u8)len;
+}
+
+static s64 _packed_size(const instruction *instr)
+{
+    s64 ret = 1;
+
+    for (u32 i = 0; i < instr->argument_count; ++i)
+        ret += 2 + _argument_length(instr->arguments + i);
+
+    return ret;
+}
+
+static u8 *_pack(const instruction *instr, u8 *out)
+{
+    *out++ = (u8)instr->argument_count;
+
+    for (u32 i = 0; i < instr->argument_count; ++i)
+    {
+        u8 len = _argument_length(instr->arguments + i);
+
+        *out++ = (u8)instr->argument_types[i];
+        *out++ = len;
+        copy_memory(instr->arguments + i, out, len);
+        out += len;
+    }
+
+    return out;
+}
+
+void build_instruction_store(const psp_disassembly *disasm, instruction_store *out, thread_pool *pool)
+{
+    s64 count = disasm->all_instructions.size;
+    s64 chunk_count = (count + ANALYSIS_CHUNK_SIZE - 1) / ANALYSIS_CHUNK_SIZE;
+
+    ::resize(&out->offsets, count);
+
+    // sizes first, so every chunk knows where its instructions go
+    array<s64> chunk_offsets{};
+    ::resize(&chunk_offsets, chunk_count + 1);
+
+    parallel_for(pool, chunk_count, [disasm, out, count, &chunk_offsets](s64 chunk_index)
+    {
+        s64 from = chunk_index * ANALYSIS_CHUNK_SIZE;
+        s64 to = Min(from + (s64)ANALYSIS_CHUNK_SIZE, count);
+        s64 size = 0;
+
+        for (s64 i = from; i < to; ++i)
+        {
+            // relative to the chunk for now
+            out->offsets.data[i] = (u32)size;
+            size += _packed_size(disasm->all_instructions.data + i);
+        }
+
+        chunk_offsets.data[chunk_index + 1] = size;
+    });
+
+    chunk_offsets.data[0] = 0;
+
+    for (s64 c = 0; c < chunk_count; ++c)
+        chunk_offsets.data[c + 1] += chunk_offsets.data[c];
+
+    ::resize(&out->data, chunk_offsets.data[chunk_count]);
+
+    parallel_for(pool, chunk_count, [disasm, out, count, &chunk_offsets](s64 chunk_index)
+    {
+        s64 from = chunk_index * ANALYSIS_CHUNK_SIZE;
+        s64 to = Min(from + (s64)ANALYSIS_CHUNK_SIZE, count);
+        u32 base = (u32)chunk_offsets.data[chunk_index];
+        u8 *at = out->data.data + base;
+
+        for (s64 i = from; i < to; ++i)
+        {
+            out->offsets.data[i] += base;
+            at = _pack(disasm->all_instructions.data + i, at);
+        }
+    });
+
+    free(&chunk_offsets);
+}
+
+void instruction_store_unpack(const instruction_store *store, const instruction_tables *tables,
+                              s64 index, instruction *out)
+{
+    fill_memory(out, 0);
+
+    out->mnemonic = (decltype(out->mnemonic))tables->mnemonics.data[index];
+    out->opcode = tables->opcodes.data[index];
+    out->address = tables->addresses.data[index];
+
+    const u8 *at = store->data.data + store->offsets.data[index];
+    u32 argument_count = Min((s64)*at++, INSTRUCTION_MAX_ARGUMENTS);
+    out->argument_count = argument_count;
+
+    for (u32 i = 0; i < argument_count; ++i)
+    {
+        u8 type = *at++;
+        u8 len = *at++;
+
+        out->argument_types[i] = (argument_type)type;
+        copy_memory(at, out->arguments + i, len);
+        at += len;
+    }
+}
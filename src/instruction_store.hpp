@@ -0,0 +1,36 @@
+
+#pragma once
+
+// Packed copy of the arguments of all_instructions for compact mode.
+// liballegrex's instruction structs reserve room for the largest number of
+// arguments of any instruction, each the size of the biggest argument type.
+// Here every instruction only stores the arguments it has, and each argument
+// only up to its last non-zero byte, which for registers and small
+// immediates is one or two bytes.
+// Mnemonic, opcode and address come from the instruction tables, so
+// together they hold everything needed to rebuild an instruction struct
+// when it's displayed or exported.
+
+#include "allegrex/disassemble.hpp"
+
+struct instruction_tables;
+struct thread_pool;
+
+struct instruction_store
+{
+    // parallel to all_instructions, offset of the instruction in data
+    array<u32> offsets;
+
+    // per instruction: argument count, then per argument its type,
+    // its length and that many bytes of it.
+    array<u8> data;
+};
+
+void init(instruction_store *store);
+void free(instruction_store *store);
+
+void build_instruction_store(const psp_disassembly *disasm, instruction_store *out, thread_pool *pool);
+
+// rebuilds instruction index into out
+void instruction_store_unpack(const instruction_store *store, const instruction_tables *tables,
+                              s64 index, instruction *out);
@@ -0,0 +1,98 @@
+
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "analysis.hpp"
+#include "instruction_tables.hpp"
+#include "thread_pool.hpp"
+
+void init(instruction_tables *tables)
+{
+    fill_memory(tables, 0);
+}
+
+void free(instruction_tables *tables)
+{
+    free(&tables->addresses);
+    free(&tables->opcodes);
+    free(&tables->mnemonics);
+    free(&tables->flags);
+}
+
+// bal, bltzal, bgezall, ...
+static bool _is_branch_and_link(const char *name)
+{
+    s64 len = (s64)string_length(name);
+
+    return (len > 2 && name[len - 2] == 'a' && name[len - 1] == 'l')
+        || (len > 3 && name[len - 3] == 'a' && name[len - 2] == 'l' && name[len - 1] == 'l');
+}
+
+u8 instruction_flags_of(const instruction *instr)
+{
+    u8 flags = 0;
+
+    for (u32 i = 0; i < instr->argument_count; ++i)
+    {
+        switch (instr->argument_types[i])
+        {
+        case argument_type::Jump_Address:         flags |= Instruction_Jump; break;
+        case argument_type::Branch_Address:       flags |= Instruction_Branch; break;
+        case argument_type::PSP_Function_Pointer: flags |= Instruction_Syscall; break;
+        default: break;
+        }
+    }
+
+    const char *name = get_mnemonic_name(instr->mnemonic);
+
+    if (flags & Instruction_Jump)
+    {
+        flags |= Instruction_Delay_Slot;
+        flags |= string_compare(name, "j") == 0 ? Instruction_Unconditional : Instruction_Call;
+    }
+    else if (flags & Instruction_Branch)
+    {
+        flags |= Instruction_Delay_Slot;
+
+        if (string_compare(name, "b") == 0)
+            flags |= Instruction_Unconditional;
+        else if (_is_branch_and_link(name))
+            flags |= Instruction_Call;
+        else
+            flags |= Instruction_Conditional;
+    }
+    else if (string_compare(name, "jr") == 0)
+        flags |= Instruction_Return | Instruction_Delay_Slot;
+    else if (string_compare(name, "jalr") == 0)
+        flags |= Instruction_Call | Instruction_Delay_Slot;
+
+    return flags;
+}
+
+void build_instruction_tables(psp_disassembly *disasm, instruction_tables *out, thread_pool *pool)
+{
+    s64 count = disasm->all_instructions.size;
+
+    ::resize(&out->addresses, count);
+    ::resize(&out->opcodes, count);
+    ::resize(&out->mnemonics, count);
+    ::resize(&out->flags, count);
+
+    s64 chunk_count = (count + ANALYSIS_CHUNK_SIZE - 1) / ANALYSIS_CHUNK_SIZE;
+
+    parallel_for(pool, chunk_count, [disasm, out, count](s64 chunk_index)
+    {
+        s64 from = chunk_index * ANALYSIS_CHUNK_SIZE;
+        s64 to = Min(from + (s64)ANALYSIS_CHUNK_SIZE, count);
+
+        for (s64 i = from; i < to; ++i)
+        {
+            const instruction *instr = disasm->all_instructions.data + i;
+
+            out->addresses.data[i] = instr->address;
+            out->opcodes.data[i] = instr->opcode;
+            out->mnemonics.data[i] = (u16)instr->mnemonic;
+            out->flags.data[i] = instruction_flags_of(instr);
+        }
+    });
+}
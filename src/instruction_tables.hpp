@@ -0,0 +1,41 @@
+
+#pragma once
+
+// Compact columns of the fields of all_instructions that scans need, built
+// once at load. Loops over many instructions read these instead of the
+// instruction structs, which carry all arguments and are much bigger.
+// The structs are only touched for instructions that are displayed, or
+// that the flags say are interesting.
+
+#include "allegrex/disassemble.hpp"
+
+struct thread_pool;
+
+enum instruction_flags : u8
+{
+    Instruction_Jump          = 1 << 0, // has a jump address (j, jal)
+    Instruction_Branch        = 1 << 1, // has a branch address
+    Instruction_Call          = 1 << 2, // jal, jalr, bal, bltzal, ...
+    Instruction_Unconditional = 1 << 3, // j, b
+    Instruction_Conditional   = 1 << 4, // every other branch that isn't a call
+    Instruction_Return        = 1 << 5, // jr, or any other jump to a register
+    Instruction_Delay_Slot    = 1 << 6, // the next instruction is a delay slot
+    Instruction_Syscall       = 1 << 7  // has a PSP function pointer argument
+};
+
+// all parallel to all_instructions
+struct instruction_tables
+{
+    array<u32> addresses;
+    array<u32> opcodes;
+    array<u16> mnemonics;
+    array<u8>  flags;
+};
+
+void init(instruction_tables *tables);
+void free(instruction_tables *tables);
+
+void build_instruction_tables(psp_disassembly *disasm, instruction_tables *out, thread_pool *pool);
+
+// control flow flags of one instruction
+u8 instruction_flags_of(const instruction *instr);
@@ -0,0 +1,356 @@
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "shl/array.hpp"
+#include "shl/assert.hpp"
+
+#include "job_scheduler.hpp"
+#include "timer.hpp"
+
+struct _job
+{
+    job_id id;
+    job_desc desc;
+    bool running;
+};
+
+struct _job_scheduler_data
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;     // for the scheduler thread
+    std::condition_variable finished; // a job was done or dropped
+    bool quit;
+
+    // jobs that aren't done yet, in the order they were added
+    array<_job> jobs;
+    job_id next_id;
+    const void *boosted;
+
+    s64 done;
+    s64 total;
+};
+
+static s64 _job_index(const _job_scheduler_data *data, job_id id)
+{
+    for (s64 i = 0; i < data->jobs.size; ++i)
+        if (data->jobs.data[i].id == id)
+            return i;
+
+    return -1;
+}
+
+static bool _is_ready(const _job_scheduler_data *data, const _job *job)
+{
+    if (job->running)
+        return false;
+
+    for (s32 i = 0; i < job->desc.dependency_count; ++i)
+        if (_job_index(data, job->desc.dependencies[i]) >= 0)
+            return false;
+
+    return true;
+}
+
+// whether l goes before r
+static bool _goes_before(const _job_scheduler_data *data, const _job *l, const _job *r)
+{
+    bool l_boosted = data->boosted != nullptr && l->desc.owner == data->boosted;
+    bool r_boosted = data->boosted != nullptr && r->desc.owner == data->boosted;
+
+    if (l_boosted != r_boosted)
+        return l_boosted;
+
+    if (l->desc.priority != r->desc.priority)
+        return l->desc.priority > r->desc.priority;
+
+    return l->id < r->id;
+}
+
+// the ready job of thread that goes first, or null. owner null means any owner.
+// call with the mutex locked.
+static _job *_next_ready(_job_scheduler_data *data, job_thread thread, const void *owner)
+{
+    _job *best = nullptr;
+
+    for_array(job, &data->jobs)
+    {
+        if (job->desc.thread != thread || !_is_ready(data, job))
+            continue;
+
+        if (owner != nullptr && job->desc.owner != owner)
+            continue;
+
+        if (best == nullptr || _goes_before(data, job, best))
+            best = job;
+    }
+
+    return best;
+}
+
+// call with the mutex locked
+static void _remove_job(_job_scheduler_data *data, s64 index)
+{
+    for (s64 i = index; i + 1 < data->jobs.size; ++i)
+        data->jobs.data[i] = data->jobs.data[i + 1];
+
+    data->jobs.size -= 1;
+
+    if (data->jobs.size == 0)
+    {
+        data->done = 0;
+        data->total = 0;
+    }
+}
+
+// call with the mutex locked
+static void _job_done(_job_scheduler_data *data, job_id id)
+{
+    s64 index = _job_index(data, id);
+
+    if (index < 0)
+        return;
+
+    data->done += 1;
+    _remove_job(data, index);
+
+    // may have made other jobs ready
+    data->wake.notify_all();
+    data->finished.notify_all();
+}
+
+static void _scheduler_main(_job_scheduler_data *data)
+{
+    std::unique_lock<std::mutex> lock(data->mutex);
+
+    while (true)
+    {
+        _job *job = nullptr;
+
+        data->wake.wait(lock, [&]()
+        {
+            job = data->quit ? nullptr : _next_ready(data, job_thread::Background, nullptr);
+            return data->quit || job != nullptr;
+        });
+
+        if (data->quit)
+            return;
+
+        job->running = true;
+        job_id id = job->id;
+        job_function run = job->desc.run;
+        void *userdata = job->desc.userdata;
+
+        // the job may move in the array while it runs
+        lock.unlock();
+
+        while (!run(userdata))
+            ;
+
+        lock.lock();
+        _job_done(data, id);
+    }
+}
+
+void init(job_scheduler *sched)
+{
+    assert(sched != nullptr);
+
+    _job_scheduler_data *data = new _job_scheduler_data{};
+    data->next_id = 1;
+    data->thread = std::thread(_scheduler_main, data);
+
+    sched->data = data;
+}
+
+void free(job_scheduler *sched)
+{
+    assert(sched != nullptr);
+
+    _job_scheduler_data *data = sched->data;
+
+    if (data == nullptr)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(data->mutex);
+        data->quit = true;
+    }
+
+    data->wake.notify_all();
+    data->thread.join();
+
+    free(&data->jobs);
+    delete data;
+
+    sched->data = nullptr;
+}
+
+job_id scheduler_add(job_scheduler *sched, const job_desc *desc)
+{
+    _job_scheduler_data *data = sched->data;
+
+    assert(desc->dependency_count <= JOB_MAX_DEPENDENCIES);
+
+    job_id id;
+
+    {
+        std::lock_guard<std::mutex> lock(data->mutex);
+        id = data->next_id++;
+        ::add_at_end(&data->jobs, _job{id, *desc, false});
+        data->total += 1;
+    }
+
+    data->wake.notify_all();
+
+    return id;
+}
+
+void scheduler_cancel(job_scheduler *sched, const void *owner)
+{
+    _job_scheduler_data *data = sched->data;
+    std::lock_guard<std::mutex> lock(data->mutex);
+
+    for (s64 i = 0; i < data->jobs.size;)
+    {
+        if (data->jobs.data[i].desc.owner == owner && !data->jobs.data[i].running)
+        {
+            data->total -= 1;
+            _remove_job(data, i);
+        }
+        else
+            ++i;
+    }
+
+    // may have been waiting on the dropped jobs
+    data->finished.notify_all();
+}
+
+void scheduler_wait(job_scheduler *sched, const void *owner)
+{
+    _job_scheduler_data *data = sched->data;
+
+    while (true)
+    {
+        job_id id = 0;
+        job_function run = nullptr;
+        void *userdata = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(data->mutex);
+
+            bool pending = false;
+
+            for_array(job, &data->jobs)
+                if (owner == nullptr || job->desc.owner == owner)
+                    pending = true;
+
+            if (!pending)
+                return;
+
+            _job *job = _next_ready(data, job_thread::Main, owner);
+
+            if (job == nullptr)
+            {
+                // waiting on the background
+                data->finished.wait(lock);
+                continue;
+            }
+
+            job->running = true;
+            id = job->id;
+            run = job->desc.run;
+            userdata = job->desc.userdata;
+        }
+
+        while (!run(userdata))
+            ;
+
+        std::lock_guard<std::mutex> lock(data->mutex);
+        _job_done(data, id);
+    }
+}
+
+void scheduler_boost(job_scheduler *sched, const void *owner)
+{
+    _job_scheduler_data *data = sched->data;
+    std::lock_guard<std::mutex> lock(data->mutex);
+    data->boosted = owner;
+}
+
+void scheduler_update(job_scheduler *sched, u64 budget_ns)
+{
+    _job_scheduler_data *data = sched->data;
+    u64 start = time_now_ns();
+
+    do
+    {
+        job_id id = 0;
+        job_function run = nullptr;
+        void *userdata = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(data->mutex);
+            _job *job = _next_ready(data, job_thread::Main, nullptr);
+
+            if (job == nullptr)
+                return;
+
+            job->running = true;
+            id = job->id;
+            run = job->desc.run;
+            userdata = job->desc.userdata;
+        }
+
+        bool done = run(userdata);
+
+        std::lock_guard<std::mutex> lock(data->mutex);
+
+        if (done)
+        {
+            _job_done(data, id);
+        }
+        else
+        {
+            s64 index = _job_index(data, id);
+
+            if (index >= 0)
+                data->jobs.data[index].running = false;
+        }
+    }
+    while (time_now_ns() - start < budget_ns);
+}
+
+bool scheduler_is_busy(job_scheduler *sched, const void *owner)
+{
+    _job_scheduler_data *data = sched->data;
+    std::lock_guard<std::mutex> lock(data->mutex);
+
+    for_array(job, &data->jobs)
+        if (owner == nullptr || job->desc.owner == owner)
+            return true;
+
+    return false;
+}
+
+void scheduler_get_status(job_scheduler *sched, scheduler_status *out)
+{
+    _job_scheduler_data *data = sched->data;
+    std::lock_guard<std::mutex> lock(data->mutex);
+
+    out->done = data->done;
+    out->total = data->total;
+    out->running = nullptr;
+    out->running_owner_name = nullptr;
+
+    for_array(job, &data->jobs)
+    {
+        if (job->running && job->desc.thread == job_thread::Background)
+        {
+            out->running = job->desc.name;
+            out->running_owner_name = job->desc.owner_name;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+
+#pragma once
+
+// Runs analysis work after a module is loaded, without holding up the UI.
+// Background jobs run one at a time on the scheduler's thread and spread
+// their passes over a thread pool themselves. Main thread jobs run in steps
+// from scheduler_update, which stops once its time budget for the frame is
+// used up.
+// A job becomes ready once all of its dependencies are done, of the ready
+// jobs the ones of the boosted owner go first, then by priority, then in
+// the order they were added.
+
+#include "shl/number_types.hpp"
+
+// 0 is never a valid id
+typedef s64 job_id;
+
+#define JOB_MAX_DEPENDENCIES 8
+
+enum class job_thread
+{
+    Background,
+    Main
+};
+
+// returns true once the job is done. background jobs are called until they
+// return true, main thread jobs once per step.
+typedef bool (*job_function)(void *userdata);
+
+struct job_desc
+{
+    const char *name;       // shown in the status, must live forever
+    const void *owner;      // what the job works on, for boosting and cancelling
+    const char *owner_name; // shown in the status, must live as long as the job
+    job_thread thread;
+    s32 priority;           // higher goes first
+
+    job_function run;
+    void *userdata;
+
+    // dependencies that aren't scheduled anymore count as done
+    job_id dependencies[JOB_MAX_DEPENDENCIES];
+    s32 dependency_count;
+};
+
+struct scheduler_status
+{
+    s64 done;  // jobs done since the scheduler was last idle
+    s64 total; // jobs added since the scheduler was last idle
+    const char *running;            // name of the running background job, or null
+    const char *running_owner_name; // owner_name of that job
+};
+
+struct _job_scheduler_data;
+
+struct job_scheduler
+{
+    _job_scheduler_data *data;
+};
+
+void init(job_scheduler *sched);
+// waits for the running background job and drops all others
+void free(job_scheduler *sched);
+
+job_id scheduler_add(job_scheduler *sched, const job_desc *desc);
+
+// drops the jobs of owner that haven't started, without waiting for the one
+// that's running, if any. the userdata of the jobs can be freed once
+// scheduler_is_busy(sched, owner) is false.
+void scheduler_cancel(job_scheduler *sched, const void *owner);
+// blocks until all jobs of owner (all jobs if owner is null) are done,
+// running main thread jobs on the calling thread. call from the main thread.
+void scheduler_wait(job_scheduler *sched, const void *owner);
+
+// the jobs of owner go before all others until another owner is boosted,
+// null boosts nobody.
+void scheduler_boost(job_scheduler *sched, const void *owner);
+
+// runs steps of ready main thread jobs for up to budget_ns,
+// call once per frame on the main thread.
+void scheduler_update(job_scheduler *sched, u64 budget_ns);
+
+// whether jobs of owner (any jobs if owner is null) are scheduled or running
+bool scheduler_is_busy(job_scheduler *sched, const void *owner);
+void scheduler_get_status(job_scheduler *sched, scheduler_status *out);
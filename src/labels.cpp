@@ -0,0 +1,204 @@
+
+#include <stdio.h> // snprintf
+
+#include "shl/memory.hpp"
+
+#include "allegrexplorer_context.hpp" // address_name
+#include "analysis.hpp"
+#include "labels.hpp"
+#include "thread_pool.hpp"
+
+void init(label_table *labels)
+{
+    fill_memory(labels, 0);
+    init(&labels->names);
+}
+
+void free(label_table *labels)
+{
+    free(&labels->handles);
+    free(&labels->outside_addresses);
+    free(&labels->outside_handles);
+    free(&labels->names);
+}
+
+const char *label_table_get_outside(const label_table *labels, u32 vaddr)
+{
+    s64 lo = 0;
+    s64 hi = labels->outside_addresses.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (labels->outside_addresses.data[mid] < vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < labels->outside_addresses.size && labels->outside_addresses.data[lo] == vaddr)
+        return string_pool_get(&labels->names, labels->outside_handles.data[lo]);
+
+    return nullptr;
+}
+
+// index of the first jump with an address >= addr
+static s64 _lower_bound_jump(const array<jump_destination> *jumps, u32 addr)
+{
+    s64 lo = 0;
+    s64 hi = jumps->size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (jumps->data[mid].address < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void _add_name(array<char> *names, const char *name)
+{
+    for (const char *c = name; *c != '\0'; ++c)
+        ::add_at_end(names, *c);
+
+    ::add_at_end(names, '\0');
+}
+
+static void _generated_label(char *buf, const jump_destination *jmp)
+{
+    if (jmp->type == jump_type::Jump)
+        snprintf(buf, 16, "func_%08x", jmp->address);
+    else
+        snprintf(buf, 16, ".L%08x", jmp->address);
+}
+
+void build_label_table(psp_disassembly *disasm, module_analysis *analysis, label_table *out, thread_pool *pool)
+{
+    s64 chunk_count = analysis->chunks.size;
+
+    ::resize(&out->handles, disasm->all_instructions.size);
+
+    for_array(handle, &out->handles)
+        *handle = 0;
+
+    // every chunk collects its names separately, then they're concatenated
+    // in chunk order so the result doesn't depend on the thread count.
+    array<array<char>> chunk_names{};
+
+    for (s64 c = 0; c < chunk_count; ++c)
+        ::add_at_end(&chunk_names, array<char>{});
+
+    parallel_for(pool, chunk_count, [disasm, analysis, out, &chunk_names](s64 chunk_index)
+    {
+        analysis_chunk *chunk = analysis->chunks.data + chunk_index;
+        array<char> *names = chunk_names.data + chunk_index;
+        array<jump_destination> *jumps = &disasm->all_jumps;
+
+        if (chunk->from >= chunk->to)
+            return;
+
+        const u32 *addresses = analysis->instructions.addresses.data;
+        s64 jump_index = _lower_bound_jump(jumps, addresses[chunk->from]);
+
+        for (s64 i = chunk->from; i < chunk->to; ++i)
+        {
+            u32 addr = addresses[i];
+
+            while (jump_index < jumps->size && jumps->data[jump_index].address < addr)
+                jump_index += 1;
+
+            const char *name = address_name(disasm, addr);
+            char buf[16];
+
+            if (name == nullptr || name[0] == '\0')
+            {
+                name = nullptr;
+
+                if (jump_index < jumps->size && jumps->data[jump_index].address == addr)
+                {
+                    _generated_label(buf, jumps->data + jump_index);
+                    name = buf;
+                }
+            }
+
+            if (name == nullptr)
+            {
+                out->handles.data[i] = 0;
+                continue;
+            }
+
+            // relative to the chunk for now, + 1 for the empty name at 0
+            out->handles.data[i] = (u32)names->size + 1;
+            _add_name(names, name);
+        }
+    });
+
+    array<u32> chunk_bases{};
+    ::resize(&chunk_bases, chunk_count);
+
+    s64 total = 0;
+
+    for (s64 c = 0; c < chunk_count; ++c)
+        total += chunk_names.data[c].size;
+
+    // handles of the chunks are relative to first - 1
+    u32 first = string_pool_reserve(&out->names, total);
+
+    for (s64 c = 0; c < chunk_count; ++c)
+    {
+        chunk_bases.data[c] = first - 1;
+        first += (u32)chunk_names.data[c].size;
+    }
+
+    parallel_for(pool, chunk_count, [analysis, out, &chunk_names, &chunk_bases](s64 chunk_index)
+    {
+        analysis_chunk *chunk = analysis->chunks.data + chunk_index;
+        array<char> *names = chunk_names.data + chunk_index;
+        u32 base = chunk_bases.data[chunk_index];
+
+        if (names->size > 0)
+            copy_memory(names->data, out->names.chars.data + base + 1, names->size);
+
+        for (s64 i = chunk->from; i < chunk->to; ++i)
+            if (out->handles.data[i] != 0)
+                out->handles.data[i] += base;
+    });
+
+    for_array(names, &chunk_names)
+        free(names);
+
+    free(&chunk_names);
+    free(&chunk_bases);
+
+    // jumps into code that wasn't disassembled, all_jumps is sorted so
+    // these are too.
+    u32 last_address = max_value(u32);
+
+    for_array(jmp, &disasm->all_jumps)
+    {
+        if (jmp->address == last_address)
+            continue;
+
+        last_address = jmp->address;
+
+        if (analysis_instruction_index(analysis, disasm, jmp->address) >= 0)
+            continue;
+
+        const char *name = address_name(disasm, jmp->address);
+
+        if (name != nullptr && name[0] != '\0')
+            continue;
+
+        char buf[16];
+        _generated_label(buf, jmp);
+
+        ::add_at_end(&out->outside_addresses, jmp->address);
+        ::add_at_end(&out->outside_handles, string_pool_add(&out->names, buf));
+    }
+}
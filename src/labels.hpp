@@ -0,0 +1,42 @@
+
+#pragma once
+
+// Precomputed label of every instruction, built once at load so displaying
+// a label is a single array read instead of symbol / import / jump lookups.
+// All label strings are interned in one pool and live as long as the module.
+
+#include "allegrex/disassemble.hpp"
+
+#include "string_pool.hpp"
+
+struct module_analysis;
+struct thread_pool;
+
+struct label_table
+{
+    // parallel to all_instructions, handle of the label in names.
+    // 0 is the empty label for instructions without a name.
+    array<u32> handles;
+
+    // unnamed jump and branch targets outside of the disassembled
+    // instructions, sorted by address, and the handles of their labels.
+    array<u32> outside_addresses;
+    array<u32> outside_handles;
+
+    string_pool names;
+};
+
+void init(label_table *labels);
+void free(label_table *labels);
+
+// symbols and imports get their name, unnamed jump targets get func_XXXXXXXX,
+// unnamed branch targets get .LXXXXXXXX.
+void build_label_table(psp_disassembly *disasm, module_analysis *analysis, label_table *out, thread_pool *pool);
+
+inline const char *label_table_get(const label_table *labels, s64 instruction_index)
+{
+    return string_pool_get(&labels->names, labels->handles.data[instruction_index]);
+}
+
+// label of a jump target that is not a disassembled instruction, or nullptr
+const char *label_table_get_outside(const label_table *labels, u32 vaddr);
@@ -4,6 +4,7 @@
 #include "shl/assert.hpp"
 #include "shl/allocator_arena.hpp"
 #include "shl/print.hpp"
+#include "shl/defer.hpp"
 
 #include "allegrex/disassemble.hpp"
 
@@ -13,8 +14,20 @@
 
 #include "psp_module_info_window.hpp"
 #include "disassembly_window.hpp"
+#include "call_graph_window.hpp"
+#include "cfg_window.hpp"
+#include "exporter.hpp"
+#include "function_browser.hpp"
+#include "job_scheduler.hpp"
 #include "log_window.hpp"
+#include "module_loader.hpp"
+#include "modules_window.hpp"
+#include "pattern_search_window.hpp"
 #include "popups.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+#include "timer.hpp"
+#include "xrefs_window.hpp"
 
 #include "ui/colorscheme.hpp"
 #include "ui/filepicker.hpp"
@@ -31,23 +44,97 @@ struct glfw_key_input
 static array<glfw_key_input> _inputs_to_process{};
 #define FRAME_RAM (1 << 20) // 1 MB
 static arena _frame_memory{};
+static thread_pool _workers{};
+static job_scheduler _scheduler{};
 
-static bool _load_psp_elf(const char *path, error *err)
+// time each frame may spend on main thread jobs of the scheduler
+#define MAIN_THREAD_JOB_BUDGET_NS 2000000 // 2 ms
+
+struct _cmdline_args
 {
-    free(&actx);
-    init(&actx);
+    s32 thread_count; // 0 = all hardware threads
+    bool no_cache;
+    bool compact;
+    array<const char*> input_paths;
+
+    // headless mode, no window is created if any of these are set
+    const char *export_path;
+    const char *dump_elf_path;
+};
+
+static bool _parse_args(int argc, const char *argv[], _cmdline_args *out)
+{
+    fill_memory(out, 0);
 
-    if (!disassemble_psp_elf(path, &actx.disasm, err))
+    for (int i = 1; i < argc; ++i)
     {
-        log_error(tformat("could not load psp elf from %s", path), err);
-        return false;
-    }
+        if (string_compare(argv[i], "--threads") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                tprint("--threads requires a number of threads\n");
+                return false;
+            }
 
-    log_message(tformat("loaded psp elf from %s", path));
+            i += 1;
+            const_string end = to_const_string(argv[i]);
+            u32 n = string_to_u32(argv[i], &end, 10);
+
+            if (end.c_str == argv[i])
+            {
+                tprint("invalid number of threads '%'\n", argv[i]);
+                return false;
+            }
+
+            out->thread_count = (s32)n;
+        }
+        else if (string_compare(argv[i], "--no-cache") == 0)
+            out->no_cache = true;
+        else if (string_compare(argv[i], "--compact") == 0)
+            out->compact = true;
+        else if (string_compare(argv[i], "--export") == 0
+              || string_compare(argv[i], "--dump-elf") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                tprint("% requires an output file\n", argv[i]);
+                return false;
+            }
+
+            if (string_compare(argv[i], "--export") == 0)
+                out->export_path = argv[i + 1];
+            else
+                out->dump_elf_path = argv[i + 1];
+
+            i += 1;
+        }
+        else
+            ::add_at_end(&out->input_paths, argv[i]);
+    }
 
     return true;
 }
 
+// progress of the scheduler at the right end of the menu bar, while it's busy
+static void _status_area()
+{
+    scheduler_status status;
+    scheduler_get_status(actx.scheduler, &status);
+
+    if (status.total == 0)
+        return;
+
+    const char *overlay = "Analyzing...";
+
+    if (status.running != nullptr)
+        overlay = tformat("Analyzing %s: %s", status.running_owner_name, status.running).c_str;
+
+    float width = 350;
+    ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - width);
+    ImGui::ProgressBar((float)status.done / (float)status.total, ImVec2(width, 0), overlay);
+    ImGui::SetItemTooltip("%lld of %lld analysis jobs done", (long long)status.done, (long long)status.total);
+}
+
 static void _menu_bar()
 {
     allegrexplorer_settings *settings = settings_get();
@@ -59,6 +146,9 @@ static void _menu_bar()
             if (ImGui::MenuItem("Open...", "Ctrl+O"))
                 imgui_open_global_popup(POPUP_OPEN_ELF);
 
+            if (ImGui::MenuItem("Close module", nullptr, nullptr, actx.workspace.active >= 0))
+                workspace_close_module(actx.workspace.active);
+
             if (ImGui::MenuItem("Export decrypted ELF...", "Ctrl+Shift+E", nullptr, actx.disasm.psp_module.elf_size > 0))
                 imgui_open_global_popup(POPUP_EXPORT_DECRYPTED_ELF);
 
@@ -88,7 +178,7 @@ static void _menu_bar()
 
             if (ImGui::BeginMenu("Disassembly"))
             {
-                // ImGui::MenuItem("Display instruction ELF offset", NULL, &settings->disassembly.show_instruction_elf_offset);
+                ImGui::MenuItem("Display instruction ELF offset", NULL, &settings->disassembly.show_instruction_elf_offset);
                 ImGui::MenuItem("Display instruction Vaddr", NULL, &settings->disassembly.show_instruction_vaddr);
                 ImGui::MenuItem("Display instruction Opcode", NULL, &settings->disassembly.show_instruction_opcode);
                 
@@ -105,6 +195,13 @@ static void _menu_bar()
         if (ImGui::BeginMenu("Settings"))
         {
             ui::ColorschemeMenu();
+
+            if (ImGui::MenuItem("Compact instructions", nullptr, &settings->loading.compact_instructions))
+                actx.compact_instructions = settings->loading.compact_instructions;
+
+            ImGui::SetItemTooltip("Modules opened from now on keep their instructions packed,\n"
+                                  "which takes much less memory but formats rows a bit slower.");
+
             ImGui::EndMenu();
         }
         
@@ -116,6 +213,8 @@ static void _menu_bar()
             ImGui::EndMenu();
         }
 
+        _status_area();
+
         ImGui::EndMenuBar();
     }
 }
@@ -156,18 +255,27 @@ static void _sections_window()
 
                 if (ImGui::TreeNode("Functions"))
                 {
-                    for (s32 i = 0; i < dsec->jump_count; ++i)
-                    {
-                        jump_destination *jmp = dsec->jumps + i;
+                    // only the visible rows are submitted
+                    s64 first = actx.analysis.section_function_offsets[_sec_i];
+                    s64 count = actx.analysis.section_function_offsets[_sec_i + 1] - first;
+                    u32 *functions = actx.analysis.section_functions.data + first;
+
+                    ImGuiListClipper clipper;
+                    clipper.Begin((int)count);
 
-                        if (jmp->type != jump_type::Jump)
-                            continue;
+                    while (clipper.Step())
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+                    {
+                        u32 addr = functions[i];
 
-                        ImGui::Text("0x%08x", jmp->address);
+                        ImGui::PushID(i);
+                        ImGui::Text("0x%08x", addr);
                         ImGui::SameLine();
 
-                        if (ImGui::SmallButton(address_label(*jmp)))
-                            goto_address(jmp->address);
+                        if (ImGui::SmallButton(address_label(addr)))
+                            goto_address(addr);
+
+                        ImGui::PopID();
                     }
 
                     ImGui::TreePop();
@@ -197,19 +305,6 @@ static void _jump_history_panel(ImGuiID dockspace_id)
 }
 */
 
-static void _debug_info_window()
-{
-    if (ImGui::Begin("Debug Info"))
-    {
-        ImGui::Text("debug text");
-    }
-
-    ImGui::End();
-}
-
-
-// disassembly_window.cpp
-void format_instruction(string *out, instruction *instr, jump_destination *out_jump);
 
 static void _show_popups()
 {
@@ -225,10 +320,7 @@ static void _show_popups()
             const_string path = to_const_string(filebuf);
 
             if (!string_is_blank(path))
-            {
-                error err{};
-                _load_psp_elf(path.c_str, &err);
-            }
+                loader_start(path.c_str);
         }
 
         ImGui::EndPopup();
@@ -262,21 +354,11 @@ static void _show_popups()
             if (!string_is_blank(path))
             {
                 error err{};
-                io_handle f = io_open(path.c_str, open_mode::WriteTrunc, &err);
 
-                if (f == INVALID_IO_HANDLE)
-                    log_error(tformat("could not open file to export decrypted elf %s", path), &err);
+                if (!export_decrypted_elf(path.c_str, &err))
+                    log_error(tformat("could not export decrypted elf to %s", path), &err);
                 else
-                {
-                    defer { io_close(f); };
-
-                    elf_psp_module *mod = &actx.disasm.psp_module;
-
-                    if (io_write(f, mod->elf_data, mod->elf_size, &err) < 0)
-                        log_error(tformat("could not write decrypted elf to %s", path), &err);
-                    else
-                        log_message(tformat("successfully exported decrypted elf to %s", path));
-                }
+                    log_message(tformat("successfully exported decrypted elf to %s", path));
             }
         }
 
@@ -339,44 +421,20 @@ static void _show_popups()
             if (!string_is_blank(path))
             {
                 error err{};
-                io_handle f = io_open(path.c_str, open_mode::WriteTrunc, &err);
+                export_stats stats{};
 
-                if (f == INVALID_IO_HANDLE)
-                    log_error(tformat("could not open file to export decrypted elf %s", path), &err);
+                if (!export_disassembly(path.c_str, &stats, &err))
+                    log_error(tformat("could not export disassembly to %s", path), &err);
                 else
                 {
-                    defer { io_close(f); };
-
-                    string line{};
-                    defer { free(&line); };
-
-                    for_array(dsec, &actx.disasm.disassembly_sections)
-                    {
-                        clear(&line);
-                        
-                        format(&line, line.size, "\n// section %s\n", dsec->section->name);
-                        io_write(f, line.data, line.size);
-
-                        for (s64 i = 0; i < dsec->instruction_count; ++i)
-                        {
-                            instruction *instr = dsec->instructions + i;
-
-                            clear(&line);
-
-                            format(&line, line.size, "/* %08x %08x %08x %-32s */ ",
-                                    (u32)dsec->section->content_offset + i * (u32)sizeof(u32),
-                                    instr->address,
-                                    instr->opcode,
-                                    address_label(instr->address));
-
-                            format_instruction(&line, instr, nullptr);
-
-                            format(&line, line.size, "\n");
-                            io_write(f, line.data, line.size);
-                        }
-                    }
+                    double secs = Max(ns_to_s(stats.duration_ns), 0.000001);
 
                     log_message(tformat("successfully exported disassembly to %s", path));
+                    log_message(tformat("exported % lines (%.2f MB) in %.1f ms, %.1f MB/s, %.0f lines/s",
+                                        stats.lines, (double)stats.bytes / (1024.0 * 1024.0),
+                                        ns_to_ms(stats.duration_ns),
+                                        ((double)stats.bytes / (1024.0 * 1024.0)) / secs,
+                                        (double)stats.lines / secs));
                 }
             }
         }
@@ -435,11 +493,15 @@ static void _process_inputs()
 static void _update(GLFWwindow *_, double dt)
 {
     arena mem = _frame_memory;
-    actx.global_alloc = get_context_pointer()->allocator;
+    actx.global_alloc = profiler_counting_allocator(get_context_pointer()->allocator);
     actx.frame_alloc = arena_allocator(&mem);
 
+    u64 frame_start = time_now_ns();
+
     imgui_new_frame();
 
+    loader_update();
+    scheduler_update(actx.scheduler, MAIN_THREAD_JOB_BUDGET_NS);
     _process_inputs();
 
     int windowflags = ImGuiWindowFlags_NoMove
@@ -463,21 +525,71 @@ static void _update(GLFWwindow *_, double dt)
             ImGui::DockSpace(dockspace_id, ImVec2(0.0f, 0.0f), ImGuiDockNodeFlags_PassthruCentralNode);
 
             ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
-            psp_module_info_window();
+            {
+                profile_frame_scope("psp_module_info_window");
+                psp_module_info_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("disassembly_window");
+                disassembly_window();
+            }
 
             ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
-            disassembly_window();
+            {
+                profile_frame_scope("_sections_window");
+                _sections_window();
+            }
 
             ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
-            _sections_window();
+            {
+                profile_frame_scope("function_browser_window");
+                function_browser_window();
+            }
 
             ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
-            log_window(actx.ui.fonts.mono);
+            {
+                profile_frame_scope("xrefs_window");
+                xrefs_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("cfg_window");
+                cfg_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("call_graph_window");
+                call_graph_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("pattern_search_window");
+                pattern_search_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("modules_window");
+                modules_window();
+            }
+
+            ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
+            {
+                profile_frame_scope("log_window");
+                log_window(actx.ui.fonts.mono);
+            }
+
+            loader_progress_window();
 
             if (actx.show_debug_info)
             {
                 ImGui::SetNextWindowDockID(dockspace_id, ImGuiCond_FirstUseEver);
-                _debug_info_window();
+                profiler_window();
 #ifndef NDEBUG
                 ImGui::ShowDemoWindow();
 #endif
@@ -488,6 +600,9 @@ static void _update(GLFWwindow *_, double dt)
     }
     ImGui::End();
 
+    profile_record_frame("frame (cpu)", time_now_ns() - frame_start);
+    profiler_frame_end(dt, (s64)((u8*)mem.current - (u8*)mem.start), FRAME_RAM);
+
     imgui_end_frame();
 }
 
@@ -497,10 +612,16 @@ static void _key_callback(GLFWwindow *window, int key, int scancode, int action,
     add_at_end(&_inputs_to_process, glfw_key_input{key, scancode, action, mods});
 }
 
-static void _setup()
+static void _setup(_cmdline_args *args)
 {
     actx.disasm = {};
 
+    init(&_workers, args->thread_count);
+    actx.workers = &_workers;
+    init(&_scheduler);
+    actx.scheduler = &_scheduler;
+    actx.use_analysis_cache = !args->no_cache;
+
     window_init();
 
     // the size is just a placeholder, since we don't load imgui settings (which hold
@@ -518,6 +639,8 @@ static void _setup()
     allegrexplorer_settings *settings = settings_get();
     ui::colorscheme_set_default();
 
+    actx.compact_instructions = args->compact || settings->loading.compact_instructions;
+
     window_set_size(actx.window, settings->window.width, settings->window.height);
 
     if (settings->window.x != 0 && settings->window.y != 0)
@@ -536,6 +659,9 @@ static void _setup()
 
 static void _cleanup()
 {
+    loader_exit();
+    pattern_search_clear();
+
     // save window size
     allegrexplorer_settings *settings = settings_get();
     
@@ -549,17 +675,91 @@ static void _cleanup()
     log_clear();
 
     free(&_frame_memory);
+    free(&actx.analysis);
     free(&actx.disasm);
+    free(&actx.workspace);
+    free(&_scheduler);
+    free(&_workers);
 }
 
-int main(int argc, const char *argv[])
+// loads the input and runs the exports given on the command line
+// without ever touching GLFW or ImGui.
+static int _run_headless(_cmdline_args *args)
 {
-    _setup();
+    if (args->input_paths.size == 0)
+    {
+        tprint("no input file given\n");
+        return 1;
+    }
+
+    init(&_workers, args->thread_count);
+    actx.workers = &_workers;
+    actx.use_analysis_cache = !args->no_cache;
+    actx.compact_instructions = args->compact;
+    actx.global_alloc = get_context_pointer()->allocator;
+    actx.frame_alloc = actx.global_alloc;
+
+    init(&actx);
+    defer { free(&actx); free(&_workers); };
 
     error err{};
 
-    if (argc > 1)
-        _load_psp_elf(argv[1], &err);
+    // exports only work on one module, the first one given
+    const char *input_path = args->input_paths[0];
+
+    if (!load_module_now(input_path, &err))
+    {
+        tprint("could not load psp elf from %: %\n", input_path, err.what);
+        return 1;
+    }
+
+    int ret = 0;
+
+    if (args->dump_elf_path != nullptr)
+    {
+        if (!export_decrypted_elf(args->dump_elf_path, &err))
+        {
+            tprint("could not export decrypted elf to %: %\n", args->dump_elf_path, err.what);
+            ret = 1;
+        }
+        else
+            tprint("exported decrypted elf to %\n", args->dump_elf_path);
+    }
+
+    if (args->export_path != nullptr)
+    {
+        export_stats stats{};
+
+        if (!export_disassembly(args->export_path, &stats, &err))
+        {
+            tprint("could not export disassembly to %: %\n", args->export_path, err.what);
+            ret = 1;
+        }
+        else
+            tprint("exported % lines (% bytes) to % in % ms\n",
+                   stats.lines, stats.bytes, args->export_path, ns_to_ms(stats.duration_ns));
+    }
+
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    _cmdline_args args{};
+
+    if (!_parse_args(argc, argv, &args))
+        return 1;
+
+    if (args.export_path != nullptr || args.dump_elf_path != nullptr)
+        return _run_headless(&args);
+
+    _setup(&args);
+
+    // modules load in parallel, the first one given becomes the active module
+    for_array(i, path, &args.input_paths)
+        loader_start(*path, i == 0);
+
+    free(&args.input_paths);
 
     // for some reason linux doesn't struggle with this and CPU usage stays at
     // sane levels, while Windows spergs out into 30%-70% CPU usage when polling.
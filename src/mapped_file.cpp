@@ -0,0 +1,122 @@
+
+#if Windows
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "shl/memory.hpp"
+
+#include "mapped_file.hpp"
+
+void init(mapped_file *mf)
+{
+    fill_memory(mf, 0);
+
+#if !Windows
+    mf->fd = -1;
+#endif
+}
+
+#if Windows
+void free(mapped_file *mf)
+{
+    if (mf->data != nullptr)
+        UnmapViewOfFile(mf->data);
+
+    if (mf->mapping_handle != nullptr)
+        CloseHandle((HANDLE)mf->mapping_handle);
+
+    if (mf->file_handle != nullptr && mf->file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle((HANDLE)mf->file_handle);
+
+    init(mf);
+}
+
+bool map_file(const char *path, mapped_file *out)
+{
+    init(out);
+
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+
+    out->file_handle = (void*)f;
+
+    LARGE_INTEGER size{};
+
+    if (!GetFileSizeEx(f, &size) || size.QuadPart <= 0)
+    {
+        free(out);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        free(out);
+        return false;
+    }
+
+    out->mapping_handle = (void*)mapping;
+    out->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (out->data == nullptr)
+    {
+        free(out);
+        return false;
+    }
+
+    out->size = (s64)size.QuadPart;
+
+    return true;
+}
+#else
+void free(mapped_file *mf)
+{
+    if (mf->data != nullptr)
+        munmap((void*)mf->data, (size_t)mf->size);
+
+    if (mf->fd >= 0)
+        close(mf->fd);
+
+    init(mf);
+}
+
+bool map_file(const char *path, mapped_file *out)
+{
+    init(out);
+
+    out->fd = open(path, O_RDONLY);
+
+    if (out->fd < 0)
+        return false;
+
+    struct stat st{};
+
+    if (fstat(out->fd, &st) != 0 || st.st_size <= 0)
+    {
+        free(out);
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, out->fd, 0);
+
+    if (data == MAP_FAILED)
+    {
+        free(out);
+        return false;
+    }
+
+    out->data = (const char*)data;
+    out->size = (s64)st.st_size;
+
+    return true;
+}
+#endif
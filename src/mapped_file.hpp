@@ -0,0 +1,25 @@
+
+#pragma once
+
+// Read-only memory mapping of a whole file.
+
+#include "shl/number_types.hpp"
+
+struct mapped_file
+{
+    const char *data;
+    s64 size;
+
+#if Windows
+    void *file_handle;
+    void *mapping_handle;
+#else
+    int fd;
+#endif
+};
+
+void init(mapped_file *mf);
+// unmaps the file, if mapped
+void free(mapped_file *mf);
+
+bool map_file(const char *path, mapped_file *out);
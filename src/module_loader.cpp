@@ -0,0 +1,573 @@
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string.h> // memcmp
+
+#include "imgui.h"
+
+#include "shl/format.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "allegrex/disassemble.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "analysis.hpp"
+#include "analysis_cache.hpp"
+#include "job_scheduler.hpp"
+#include "log_window.hpp"
+#include "mapped_file.hpp"
+#include "module_loader.hpp"
+#include "profiler.hpp"
+#include "workspace.hpp"
+
+enum class _load_state : int
+{
+    Running,
+    Finished,
+    Abandoned
+};
+
+enum class _load_stage : int
+{
+    Decoding,
+    Analyzing
+};
+
+struct _load_job
+{
+    string path;
+    bool activate; // becomes the active module when done
+    bool compact;  // see actx.compact_instructions
+
+    // whichever thread fails to move the state away from Running owns the job
+    // and has to free it.
+    std::atomic<int> state;
+    std::atomic<int> stage;
+
+    bool success;
+    string error_message;
+
+    psp_disassembly disasm;
+    module_analysis analysis;
+};
+
+// loads in progress, each on its own thread
+static array<_load_job*> _jobs{};
+
+struct _finish_job;
+
+struct _pass_job
+{
+    _finish_job *finish;
+    late_pass pass;
+};
+
+// late analysis passes of a module that's in the workspace already, run by
+// actx.scheduler. the module borrows the analysis of the first passes from
+// the job until the job is published.
+// if the module is closed first, the job takes over its disassembly and
+// frees everything once its running pass is done, see loader_update.
+struct _finish_job
+{
+    workspace_module *module; // null once closed
+    char name[PRX_MODULE_NAME_LEN + 1];
+    bool compact;
+
+    // disasm is a copy of the module's, which the job only reads, and owns
+    // once the module is closed. analysis owns the arrays of all passes.
+    psp_disassembly disasm;
+    module_analysis analysis;
+
+    // copy of analysis, packed, which the module takes over when done
+    module_analysis packed;
+
+    _pass_job passes[LATE_PASS_COUNT];
+};
+
+static array<_finish_job*> _finish_jobs{};
+
+// number of worker threads still running, including cancelled ones
+static std::atomic<int> _running_workers{0};
+
+static void _free_job(_load_job *job)
+{
+    free(&job->path);
+    free(&job->error_message);
+    free(&job->analysis);
+    free(&job->disasm);
+    delete job;
+}
+
+static bool _is_plain_elf(const mapped_file *input)
+{
+    return input->size >= 4 && memcmp(input->data, "\x7f" "ELF", 4) == 0;
+}
+
+// decodes and analyzes the module at path, going through the analysis cache
+// if enabled. stops after decoding if the job is cancelled.
+// jobs only run the first analysis passes, the rest runs once the module is
+// in the workspace. without a job (job = null) everything runs here.
+static bool _load_module(const char *path, psp_disassembly *disasm, module_analysis *analysis,
+                         bool compact, _load_job *job, error *err)
+{
+    bool use_cache = false;
+    bool plain_elf = false;
+    s64 input_size = 0;
+    u64 input_hash = 0;
+    bool decoded = false;
+
+    // the file is only mapped to hash it for the cache. decoding reads it into
+    // elf_data anyway, which is what the module keeps and exports from.
+    if (actx.use_analysis_cache)
+    {
+        mapped_file input;
+        init(&input);
+
+        if (map_file(path, &input))
+        {
+            profile_scope("hash input");
+            use_cache = true;
+            plain_elf = _is_plain_elf(&input);
+            input_size = input.size;
+            input_hash = hash_module_data(input.data, input.size);
+        }
+
+        free(&input);
+    }
+
+    if (use_cache && !plain_elf)
+    {
+        // encrypted modules are decoded from their cached decrypted elf, if there is one
+        char elf_path[4096];
+
+        if (analysis_cache_elf_path(input_hash, elf_path, 4096))
+        {
+            profile_scope("decode (cached elf)");
+            decoded = disassemble_psp_elf(elf_path, disasm, err);
+
+            if (!decoded)
+            {
+                free(disasm);
+                init(disasm);
+                *err = error{};
+            }
+        }
+    }
+
+    if (!decoded)
+    {
+        {
+            profile_scope("decrypt + decode");
+
+            if (!disassemble_psp_elf(path, disasm, err))
+                return false;
+        }
+
+        if (use_cache && !plain_elf)
+            analysis_cache_store_elf(input_hash, disasm);
+    }
+
+    if (job != nullptr)
+    {
+        if (job->state.load() != (int)_load_state::Running)
+            return true;
+
+        job->stage = (int)_load_stage::Analyzing;
+    }
+
+    bool cached = false;
+
+    if (use_cache)
+    {
+        profile_scope("analysis cache load");
+        cached = analysis_cache_load(input_hash, input_size, disasm, analysis);
+    }
+
+    analyze_module_first_passes(disasm, analysis, actx.workers);
+
+    // only the results of the first passes are cached
+    if (use_cache && !cached)
+    {
+        profile_scope("analysis cache store");
+        analysis_cache_store(input_hash, input_size, disasm, analysis);
+    }
+
+    if (job != nullptr)
+        return true;
+
+    analyze_module_late_passes(disasm, analysis, actx.workers);
+
+    if (compact)
+    {
+        profile_scope("compact instructions");
+        compact_instructions(disasm, analysis, actx.workers);
+    }
+
+    {
+        profile_scope("analysis pack");
+        analysis_pack(analysis);
+    }
+
+    return true;
+}
+
+static void _load_worker(_load_job *job)
+{
+    error err{};
+
+    init(&job->disasm);
+    init(&job->analysis);
+
+    job->stage = (int)_load_stage::Decoding;
+    job->success = _load_module(job->path.data, &job->disasm, &job->analysis, job->compact, job, &err);
+
+    if (!job->success)
+        string_set(&job->error_message, err.what);
+
+    int expected = (int)_load_state::Running;
+
+    if (!job->state.compare_exchange_strong(expected, (int)_load_state::Finished))
+        _free_job(job); // cancelled while we were working
+
+    _running_workers -= 1;
+}
+
+static bool _run_pass(void *userdata)
+{
+    _pass_job *pjob = (_pass_job*)userdata;
+    run_late_pass(pjob->pass, &pjob->finish->disasm, &pjob->finish->analysis, actx.workers);
+    return true;
+}
+
+static bool _run_compact(void *userdata)
+{
+    _finish_job *job = (_finish_job*)userdata;
+
+    profile_scope("compact instructions");
+    build_instruction_store(&job->disasm, &job->analysis.store, actx.workers);
+    return true;
+}
+
+static bool _run_pack(void *userdata)
+{
+    _finish_job *job = (_finish_job*)userdata;
+
+    profile_scope("analysis pack");
+    analysis_pack_copy(&job->analysis, &job->packed);
+    return true;
+}
+
+static void _free_finish_job(_finish_job *job)
+{
+    for_array(i, other, &_finish_jobs)
+    {
+        if (*other == job)
+        {
+            for (s64 j = i; j + 1 < _finish_jobs.size; ++j)
+                _finish_jobs[j] = _finish_jobs[j + 1];
+
+            _finish_jobs.size -= 1;
+            break;
+        }
+    }
+
+    if (job->module == nullptr)
+        free(&job->disasm);
+
+    free(&job->analysis);
+    free(&job->packed);
+    delete job;
+}
+
+// main thread, the module takes over the complete analysis
+static bool _run_publish(void *userdata)
+{
+    _finish_job *job = (_finish_job*)userdata;
+
+    workspace_finish_module(job->module, &job->packed, job->compact);
+    log_message(tformat("finished analyzing %s", job->module->path.data));
+
+    _free_finish_job(job);
+    return true;
+}
+
+static job_id _schedule(const char *name, _finish_job *job, job_thread thread, s32 priority,
+                        job_function run, void *userdata,
+                        const job_id *dependencies = nullptr, s32 dependency_count = 0)
+{
+    job_desc desc{};
+    desc.name = name;
+    desc.owner = job;
+    desc.owner_name = job->name;
+    desc.thread = thread;
+    desc.priority = priority;
+    desc.run = run;
+    desc.userdata = userdata;
+    desc.dependency_count = dependency_count;
+
+    for (s32 i = 0; i < dependency_count; ++i)
+        desc.dependencies[i] = dependencies[i];
+
+    return scheduler_add(actx.scheduler, &desc);
+}
+
+// schedules the late passes of mod, whose analysis is taken over by the job.
+// what windows need most goes first: functions and the search index, then
+// call graph and xrefs, then the passes that only save memory.
+static void _start_finish_job(workspace_module *mod, psp_disassembly *disasm, module_analysis *analysis, bool compact)
+{
+    _finish_job *job = new _finish_job{};
+    job->module = mod;
+    copy_memory(mod->name, job->name, sizeof(job->name));
+    job->compact = compact;
+    job->disasm = *disasm;
+    job->analysis = *analysis;
+    job->packed = {};
+
+    mod->analyzing = true;
+    ::add_at_end(&_finish_jobs, job);
+
+    for (s32 i = 0; i < LATE_PASS_COUNT; ++i)
+        job->passes[i] = _pass_job{job, (late_pass)i};
+
+    job_id done[5];
+    s32 done_count = 0;
+
+    job_id functions = _schedule("function table", job, job_thread::Background, 3, _run_pass,
+                                 job->passes + (int)late_pass::Functions);
+    done[done_count++] = functions;
+    done[done_count++] = _schedule("search index", job, job_thread::Background, 3, _run_pass,
+                                   job->passes + (int)late_pass::SearchIndex);
+    done[done_count++] = _schedule("call graph", job, job_thread::Background, 2, _run_pass,
+                                   job->passes + (int)late_pass::CallGraph, &functions, 1);
+    done[done_count++] = _schedule("xref index", job, job_thread::Background, 2, _run_pass,
+                                   job->passes + (int)late_pass::Xrefs);
+
+    if (compact)
+        done[done_count++] = _schedule("compact instructions", job, job_thread::Background, 1, _run_compact, job);
+
+    job_id pack = _schedule("analysis pack", job, job_thread::Background, 0, _run_pack, job, done, done_count);
+    _schedule("publish analysis", job, job_thread::Main, 0, _run_publish, job, &pack, 1);
+}
+
+static void _cancel_job(s64 index)
+{
+    _load_job *job = _jobs[index];
+
+    for (s64 i = index; i + 1 < _jobs.size; ++i)
+        _jobs[i] = _jobs[i + 1];
+
+    _jobs.size -= 1;
+
+    log_message(tformat("cancelled loading %s", job->path.data));
+
+    int expected = (int)_load_state::Running;
+
+    // if the worker is done already we have to clean up, otherwise the worker does
+    if (!job->state.compare_exchange_strong(expected, (int)_load_state::Abandoned))
+        _free_job(job);
+}
+
+void loader_start(const char *path, bool activate)
+{
+    for_array(i, other, &_jobs)
+    {
+        if (string_compare((*other)->path.data, path) == 0)
+        {
+            _cancel_job(i);
+            break;
+        }
+    }
+
+    _load_job *job = new _load_job{};
+    string_set(&job->path, path);
+    job->activate = activate;
+    job->compact = actx.compact_instructions;
+    job->state = (int)_load_state::Running;
+    job->stage = (int)_load_stage::Decoding;
+
+    ::add_at_end(&_jobs, job);
+    _running_workers += 1;
+
+    std::thread(_load_worker, job).detach();
+}
+
+void loader_cancel()
+{
+    while (_jobs.size > 0)
+        _cancel_job(_jobs.size - 1);
+}
+
+void loader_drop_analysis(workspace_module *mod)
+{
+    for_array(job_, &_finish_jobs)
+    {
+        _finish_job *job = *job_;
+
+        if (job->module != mod)
+            continue;
+
+        // a running pass can't be interrupted, the job is freed once it's done
+        scheduler_cancel(actx.scheduler, job);
+        job->module = nullptr;
+
+        mod->disasm = {};
+        mod->analysis = {};
+        return;
+    }
+}
+
+bool load_module_now(const char *path, error *err)
+{
+    psp_disassembly disasm;
+    module_analysis analysis;
+    init(&disasm);
+    init(&analysis);
+
+    if (!_load_module(path, &disasm, &analysis, actx.compact_instructions, nullptr, err))
+    {
+        free(&analysis);
+        free(&disasm);
+        return false;
+    }
+
+    workspace_add_module(path, &disasm, &analysis, true);
+    return true;
+}
+
+void loader_exit()
+{
+    loader_cancel();
+    free(&_jobs);
+
+    // the late passes can't be interrupted, so they're finished instead
+    if (_finish_jobs.size > 0)
+        scheduler_wait(actx.scheduler, nullptr);
+
+    // jobs of closed modules
+    while (_finish_jobs.size > 0)
+        _free_finish_job(_finish_jobs[0]);
+
+    free(&_finish_jobs);
+
+    while (_running_workers.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+bool loader_is_loading()
+{
+    return _jobs.size > 0;
+}
+
+void loader_update()
+{
+    // the passes of the module being looked at go first
+    const module_workspace *ws = &actx.workspace;
+    const workspace_module *active = ws->active >= 0 ? ws->modules[ws->active] : nullptr;
+    const _finish_job *boosted = nullptr;
+
+    for (s64 i = 0; i < _finish_jobs.size;)
+    {
+        _finish_job *job = _finish_jobs[i];
+
+        if (job->module == nullptr && !scheduler_is_busy(actx.scheduler, job))
+        {
+            // closed and done with its last pass
+            _free_finish_job(job);
+            continue;
+        }
+
+        if (active != nullptr && job->module == active)
+            boosted = job;
+
+        ++i;
+    }
+
+    scheduler_boost(actx.scheduler, boosted);
+
+    for (s64 i = 0; i < _jobs.size;)
+    {
+        _load_job *job = _jobs[i];
+
+        if (job->state.load() != (int)_load_state::Finished)
+        {
+            ++i;
+            continue;
+        }
+
+        for (s64 j = i; j + 1 < _jobs.size; ++j)
+            _jobs[j] = _jobs[j + 1];
+
+        _jobs.size -= 1;
+
+        if (!job->success)
+        {
+            log_error(tformat("could not load psp elf from %s: %s", job->path.data, job->error_message.data));
+            _free_job(job);
+            continue;
+        }
+
+        // ownership of the disassembly moves to the workspace, the analysis
+        // goes to a finish job and is borrowed by the module until it's done.
+        psp_disassembly disasm = job->disasm;
+        module_analysis analysis = job->analysis;
+        workspace_module *mod = workspace_add_module(job->path.data, &job->disasm, &job->analysis, job->activate);
+        _start_finish_job(mod, &disasm, &analysis, job->compact);
+
+        log_message(tformat("loaded psp elf from %s", job->path.data));
+
+        _free_job(job);
+    }
+}
+
+void loader_progress_window()
+{
+    if (_jobs.size == 0)
+        return;
+
+    ImGuiViewport *viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x * 0.5f,
+                                   viewport->WorkPos.y + viewport->WorkSize.y * 0.5f),
+                            ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+
+    int flags = ImGuiWindowFlags_NoDecoration
+              | ImGuiWindowFlags_AlwaysAutoResize
+              | ImGuiWindowFlags_NoSavedSettings
+              | ImGuiWindowFlags_NoDocking;
+
+    if (ImGui::Begin("Loading##loader_progress", nullptr, flags))
+    {
+        s64 cancel = -1;
+
+        for_array(i, job_, &_jobs)
+        {
+            _load_job *job = *job_;
+            ImGui::PushID((int)i);
+
+            if (i > 0)
+                ImGui::Separator();
+
+            ImGui::Text("Loading %s", job->path.data);
+
+            const char *stage_text = "Decrypting and disassembling...";
+
+            if (job->stage.load() == (int)_load_stage::Analyzing)
+                stage_text = "Analyzing...";
+
+            // a negative, animated fraction makes an indeterminate progress bar
+            ImGui::ProgressBar(-1.0f * (float)ImGui::GetTime(), ImVec2(400, 0), stage_text);
+
+            if (ImGui::Button("Cancel"))
+                cancel = i;
+
+            ImGui::PopID();
+        }
+
+        if (cancel >= 0)
+            _cancel_job(cancel);
+    }
+
+    ImGui::End();
+}
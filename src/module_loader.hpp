@@ -0,0 +1,42 @@
+
+#pragma once
+
+// Loads PSP modules on worker threads so the UI doesn't freeze while
+// a large (E)BOOT.BIN is being decrypted and disassembled.
+// Several modules can load at once, each on its own thread. Loaded modules
+// are added to the workspace, the active one stays browsable meanwhile.
+// A module is added as soon as it's decoded and the passes the disassembly
+// needs are done, the late analysis passes are left to actx.scheduler.
+
+#include "shl/error.hpp"
+
+struct workspace_module;
+
+// loads the module at path into the workspace on the calling thread and
+// makes it the active module
+bool load_module_now(const char *path, error *err);
+
+// starts loading the module at path, cancelling a load of the same path.
+// if activate is set, the module becomes the active module once it's loaded.
+void loader_start(const char *path, bool activate = true);
+// cancels all loads in progress
+void loader_cancel();
+bool loader_is_loading();
+
+// cancels any load, waits for cancelled workers to wind down and for the
+// late passes of loaded modules to finish. call before tearing down the worker
+// pool and the scheduler.
+void loader_exit();
+
+// call once per frame on the main thread, publishes finished loads into the
+// workspace and writes load results to the log. the late passes of the
+// active module are boosted in the scheduler.
+void loader_update();
+
+// for modules closed while still analyzing, see workspace_module.analyzing.
+// drops the late passes of mod that haven't started and takes over its
+// disassembly and analysis, which are freed once the running pass is done.
+void loader_drop_analysis(workspace_module *mod);
+
+// small window with a progress bar and a cancel button per load, only visible while loading
+void loader_progress_window();
@@ -0,0 +1,254 @@
+#include "imgui.h"
+
+#include "shl/compare.hpp"
+#include "shl/format.hpp"
+#include "shl/string.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "modules_window.hpp"
+#include "workspace.hpp"
+
+static void _modules_table()
+{
+    module_workspace *ws = &actx.workspace;
+
+    s64 activate = -1;
+    s64 close = -1;
+    s64 total_memory = 0;
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg
+                          | ImGuiTableFlags_Borders
+                          | ImGuiTableFlags_Resizable
+                          | ImGuiTableFlags_SizingFixedFit;
+
+    if (ImGui::BeginTable("modules", 6, flags))
+    {
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Instructions");
+        ImGui::TableSetupColumn("Exports");
+        ImGui::TableSetupColumn("Memory");
+        ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("");
+        ImGui::TableHeadersRow();
+
+        for_array(i, mod_, &ws->modules)
+        {
+            workspace_module *mod = *mod_;
+            total_memory += mod->memory.total;
+
+            ImGui::PushID((int)i);
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            if (ImGui::Selectable(mod->name[0] != '\0' ? mod->name : "(unnamed)", i == ws->active,
+                                  ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+                activate = i;
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%lld", (long long)mod->instruction_count);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%lld", (long long)mod->exports.size);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f MB", (double)mod->memory.total / (1024.0 * 1024.0));
+
+            if (mod->analyzing)
+            {
+                ImGui::SameLine();
+                ImGui::TextDisabled("(analyzing)");
+            }
+
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(mod->path.data);
+
+            ImGui::TableNextColumn();
+            if (ImGui::SmallButton("Close"))
+                close = i;
+
+            ImGui::PopID();
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("%lld modules, %.2f MB", (long long)ws->modules.size, (double)total_memory / (1024.0 * 1024.0));
+
+    // after the table, the active module changes here
+    if (close >= 0)
+        workspace_close_module(close);
+    else if (activate >= 0)
+        workspace_activate(activate);
+}
+
+static void _memory_table(const workspace_module *mod, bool compact)
+{
+    const memory_report *report = &mod->memory;
+    double instructions = (double)Max(mod->instruction_count, (s64)1);
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg
+                          | ImGuiTableFlags_Borders
+                          | ImGuiTableFlags_SizingFixedFit;
+
+    if (ImGui::BeginTable("memory", 4, flags))
+    {
+        ImGui::TableSetupColumn("Structure");
+        ImGui::TableSetupColumn("Size");
+        ImGui::TableSetupColumn("Share");
+        ImGui::TableSetupColumn("Per instruction");
+        ImGui::TableHeadersRow();
+
+        for (s32 i = 0; i < report->count; ++i)
+        {
+            const memory_report_entry *e = report->entries + i;
+
+            if (e->bytes == 0)
+                continue;
+
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(e->name);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f MB", (double)e->bytes / (1024.0 * 1024.0));
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", report->total > 0 ? 100.0 * (double)e->bytes / (double)report->total : 0.0);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f B", (double)e->bytes / instructions);
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("%.2f MB, %.1f bytes per instruction", (double)report->total / (1024.0 * 1024.0),
+                (double)report->total / instructions);
+
+    if (compact)
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(compact)");
+    }
+}
+
+static void _imports_table()
+{
+    module_workspace *ws = &actx.workspace;
+
+    // the imports table is small, collecting and sorting it every frame is fine
+    array<u32> stubs{};
+    stubs.allocator = actx.frame_alloc;
+
+    for_hash_table(addr, fimp, &actx.disasm.psp_module.imports)
+        ::add_at_end(&stubs, *addr);
+
+    compare_function_p<u32> compare_addresses =
+        [](const u32 *l, const u32 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(stubs.data, stubs.size, compare_addresses);
+
+    s64 goto_module = -1;
+    u32 goto_vaddr = 0;
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg
+                          | ImGuiTableFlags_Borders
+                          | ImGuiTableFlags_Resizable
+                          | ImGuiTableFlags_ScrollY
+                          | ImGuiTableFlags_SizingFixedFit;
+
+    if (ImGui::BeginTable("imports", 4, flags))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Stub");
+        ImGui::TableSetupColumn("NID");
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Resolves to", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)stubs.size);
+
+        while (clipper.Step())
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            u32 stub = stubs[i];
+            function_import *fimp = ::search(&actx.disasm.psp_module.imports, &stub);
+
+            ImGui::PushID(i);
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            if (ImGui::SmallButton(tformat("%08x", stub).c_str))
+            {
+                goto_module = ws->active;
+                goto_vaddr = stub;
+            }
+
+            // imports of unknown libraries have no function
+            if (fimp->function != nullptr)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%08x", fimp->function->nid);
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(fimp->function->name);
+            }
+            else
+            {
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("????????");
+
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("unknown");
+            }
+
+            ImGui::TableNextColumn();
+            const nid_export *exp = workspace_resolve_import(stub);
+
+            if (exp == nullptr)
+                ImGui::TextDisabled("unresolved");
+            else if (ImGui::SmallButton(tformat("%s 0x%08x", ws->modules[exp->module]->name, exp->address).c_str))
+            {
+                goto_module = exp->module;
+                goto_vaddr = exp->address;
+            }
+
+            ImGui::PopID();
+        }
+
+        ImGui::EndTable();
+    }
+
+    free(&stubs);
+
+    if (goto_module >= 0)
+        goto_module_address(goto_module, goto_vaddr);
+}
+
+void modules_window()
+{
+    if (ImGui::Begin("Modules"))
+    {
+        ImGui::PushFont(actx.ui.fonts.mono);
+
+        _modules_table();
+
+        if (actx.workspace.active >= 0)
+        {
+            ImGui::SeparatorText("Memory of the active module");
+            _memory_table(actx.workspace.modules[actx.workspace.active], actx.analysis.store.offsets.size > 0);
+
+            ImGui::SeparatorText("Imports of the active module");
+            _imports_table();
+        }
+
+        ImGui::PopFont();
+    }
+
+    ImGui::End();
+}
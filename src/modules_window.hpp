@@ -0,0 +1,6 @@
+
+#pragma once
+
+// lists the modules of the workspace with their memory use, switches between
+// them and shows which loaded module the imports of the active module resolve to
+void modules_window();
@@ -0,0 +1,319 @@
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string.h> // memcpy
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "pattern_search.hpp"
+#include "thread_pool.hpp"
+#include "timer.hpp"
+
+// words per unit of work, big sections are split into several
+#define PATTERN_SEARCH_CHUNK_WORDS 65536
+
+struct _search_chunk
+{
+    const char *data; // the words, opcodes or elf
+    u32 elf_offset;
+    u32 word_count;
+    u32 vaddr; // of the first word, max_value(u32) if not in a section
+};
+
+struct _search_job
+{
+    u32 value;
+    u32 mask;
+
+    array<_search_chunk> chunks;
+
+    std::thread thread;
+    std::atomic<bool> cancel;
+    std::atomic<bool> finished;
+    std::atomic<s64> chunks_done;
+
+    // found by the workers, not taken over by the main thread yet
+    std::mutex pending_mutex;
+    array<pattern_match> pending;
+
+    u64 start_ns;
+    std::atomic<u64> duration_ns;
+};
+
+static _search_job *_job = nullptr;
+static array<pattern_match> _results{};
+static bool _results_sorted = false;
+
+static void _add_chunks(array<_search_chunk> *chunks, const char *data, u32 elf_offset, u32 size, u32 vaddr)
+{
+    u32 words = size / sizeof(u32);
+
+    for (u32 w = 0; w < words; w += PATTERN_SEARCH_CHUNK_WORDS)
+    {
+        _search_chunk chunk{};
+        chunk.data = data + w * sizeof(u32);
+        chunk.elf_offset = elf_offset + w * (u32)sizeof(u32);
+        chunk.word_count = Min(words - w, (u32)PATTERN_SEARCH_CHUNK_WORDS);
+        chunk.vaddr = vaddr == max_value(u32) ? vaddr : vaddr + w * (u32)sizeof(u32);
+        ::add_at_end(chunks, chunk);
+    }
+}
+
+static void _scan_chunk(_search_job *job, const _search_chunk *chunk, array<pattern_match> *out)
+{
+    const char *data = chunk->data;
+    const u32 value = job->value & job->mask;
+    const u32 mask = job->mask;
+    const u32 count = chunk->word_count;
+
+    auto add_match = [chunk, out](u32 w)
+    {
+        pattern_match m{};
+        m.elf_offset = chunk->elf_offset + w * (u32)sizeof(u32);
+        m.vaddr = chunk->vaddr == max_value(u32) ? max_value(u32) : chunk->vaddr + w * (u32)sizeof(u32);
+        ::add_at_end(out, m);
+    };
+
+    // blocks of 8 words without branches in the compare, so the compiler
+    // can use SIMD compares. the module is little endian, like the hosts
+    // we run on.
+    u32 w = 0;
+
+    for (; w + 8 <= count; w += 8)
+    {
+        u32 words[8];
+        memcpy(words, data + w * sizeof(u32), sizeof(words));
+
+        u32 hits = 0;
+
+        for (u32 k = 0; k < 8; ++k)
+            hits |= (u32)((words[k] & mask) == value) << k;
+
+        if (hits == 0)
+            continue;
+
+        for (u32 k = 0; k < 8; ++k)
+            if (hits & (1u << k))
+                add_match(w + k);
+    }
+
+    for (; w < count; ++w)
+    {
+        u32 word;
+        memcpy(&word, data + w * sizeof(u32), sizeof(word));
+
+        if ((word & mask) == value)
+            add_match(w);
+    }
+}
+
+static void _run_search(_search_job *job)
+{
+    parallel_for(actx.workers, job->chunks.size, [job](s64 chunk_index)
+    {
+        if (job->cancel.load())
+            return;
+
+        array<pattern_match> found{};
+        _scan_chunk(job, job->chunks.data + chunk_index, &found);
+
+        if (found.size > 0)
+        {
+            std::lock_guard<std::mutex> lock(job->pending_mutex);
+
+            for_array(m, &found)
+                ::add_at_end(&job->pending, *m);
+        }
+
+        free(&found);
+        job->chunks_done.fetch_add(1);
+    });
+
+    job->duration_ns.store(time_now_ns() - job->start_ns);
+    job->finished.store(true);
+}
+
+void pattern_search_clear()
+{
+    if (_job != nullptr)
+    {
+        _job->cancel.store(true);
+
+        if (_job->thread.joinable())
+            _job->thread.join();
+
+        free(&_job->chunks);
+        free(&_job->pending);
+        delete _job;
+        _job = nullptr;
+    }
+
+    free(&_results);
+    _results_sorted = false;
+}
+
+void pattern_search_start(u32 value, u32 mask, pattern_search_scope scope)
+{
+    pattern_search_clear();
+
+    _job = new _search_job();
+    _job->value = value;
+    _job->mask = mask;
+    _job->cancel.store(false);
+    _job->finished.store(false);
+    _job->chunks_done.store(0);
+    _job->duration_ns.store(0);
+    _job->start_ns = time_now_ns();
+
+    if (scope == pattern_search_scope::Code)
+    {
+        // the opcode column is dense and ordered like the sections
+        const u32 *opcodes = actx.analysis.instructions.opcodes.data;
+
+        for_array(range, &actx.analysis.section_ranges)
+            _add_chunks(&_job->chunks, (const char*)(opcodes + range->first_index), range->elf_offset,
+                        (u32)(range->count * (s64)sizeof(u32)), range->vaddr);
+    }
+    else
+    {
+        s64 elf_size = 0;
+        const char *elf_data = module_elf_data(&elf_size);
+
+        if (elf_data != nullptr)
+            _add_chunks(&_job->chunks, elf_data, 0, (u32)elf_size, max_value(u32));
+    }
+
+    _job->thread = std::thread(_run_search, _job);
+}
+
+bool pattern_search_running()
+{
+    return _job != nullptr && !_job->finished.load();
+}
+
+// vaddr of a match of a whole elf search, from the sections
+static u32 _vaddr_of_offset(u32 elf_offset)
+{
+    for_array(dsec, &actx.disasm.disassembly_sections)
+    {
+        u32 start = (u32)dsec->section->content_offset;
+
+        if (elf_offset >= start && elf_offset < start + (u32)dsec->section->content_size)
+            return dsec->section->vaddr + (elf_offset - start);
+    }
+
+    return max_value(u32);
+}
+
+void pattern_search_update()
+{
+    if (_job == nullptr)
+        return;
+
+    bool finished = _job->finished.load();
+
+    if (!_results_sorted)
+    {
+        std::lock_guard<std::mutex> lock(_job->pending_mutex);
+
+        for_array(m, &_job->pending)
+        {
+            pattern_match match = *m;
+
+            if (match.vaddr == max_value(u32))
+                match.vaddr = _vaddr_of_offset(match.elf_offset);
+
+            ::add_at_end(&_results, match);
+        }
+
+        clear(&_job->pending);
+    }
+
+    if (finished && !_results_sorted)
+    {
+        compare_function_p<pattern_match> compare_matches =
+            [](const pattern_match *l, const pattern_match *r)
+            {
+                return compare_ascending(l->elf_offset, r->elf_offset);
+            };
+
+        ::sort(_results.data, _results.size, compare_matches);
+        _results_sorted = true;
+    }
+}
+
+const array<pattern_match> *pattern_search_results()
+{
+    return &_results;
+}
+
+float pattern_search_progress()
+{
+    if (_job == nullptr || _job->chunks.size == 0)
+        return 1.f;
+
+    return (float)_job->chunks_done.load() / (float)_job->chunks.size;
+}
+
+u64 pattern_search_duration_ns()
+{
+    if (_job == nullptr)
+        return 0;
+
+    if (!_job->finished.load())
+        return time_now_ns() - _job->start_ns;
+
+    return _job->duration_ns.load();
+}
+
+static int _hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+
+    return -1;
+}
+
+bool parse_search_pattern(const char *text, u32 *out_value, u32 *out_mask)
+{
+    u32 value = 0;
+    u32 mask = 0;
+    s32 digits = 0;
+
+    for (const char *c = text; *c != '\0'; ++c)
+    {
+        if (*c == ' ' || *c == '_')
+            continue;
+
+        if (digits >= 8)
+            return false;
+
+        value <<= 4;
+        mask <<= 4;
+
+        if (*c != '?')
+        {
+            int d = _hex_digit(*c);
+
+            if (d < 0)
+                return false;
+
+            value |= (u32)d;
+            mask |= 0xf;
+        }
+
+        digits += 1;
+    }
+
+    if (digits != 8)
+        return false;
+
+    *out_value = value;
+    *out_mask = mask;
+
+    return true;
+}
@@ -0,0 +1,44 @@
+
+#pragma once
+
+// Masked search for 32-bit words (opcodes, constants, ...) in the loaded
+// module. A word matches if (word & mask) == (value & mask).
+// Runs in the background, split across the worker pool by section, and
+// hands over results while it runs.
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+
+struct pattern_match
+{
+    u32 elf_offset;
+    u32 vaddr; // max_value(u32) if the word is in no section
+};
+
+enum class pattern_search_scope
+{
+    Code,     // opcodes of the disassembled instructions
+    Whole_Elf // every aligned word of the decrypted elf
+};
+
+// cancels a running search and starts a new one on actx
+void pattern_search_start(u32 value, u32 mask, pattern_search_scope scope);
+
+// cancels a running search and drops the results,
+// call before the module being searched is freed.
+void pattern_search_clear();
+
+bool pattern_search_running();
+
+// call once per frame on the main thread, takes over results found since
+// the last call. results are sorted once the search is done.
+void pattern_search_update();
+
+const array<pattern_match> *pattern_search_results();
+
+// [0, 1]
+float pattern_search_progress();
+u64 pattern_search_duration_ns();
+
+// parses 8 hex digits, '?' is a wildcard nibble. e.g. "27bdff??"
+bool parse_search_pattern(const char *text, u32 *out_value, u32 *out_mask);
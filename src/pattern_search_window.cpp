@@ -0,0 +1,111 @@
+
+#include "imgui.h"
+
+#include "shl/format.hpp"
+#include "shl/string.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "instruction_format.hpp"
+#include "pattern_search.hpp"
+#include "pattern_search_window.hpp"
+#include "timer.hpp"
+
+void pattern_search_window()
+{
+    static char _pattern[64] = {};
+    static u32 _mask = max_value(u32);
+    static int _scope = (int)pattern_search_scope::Code;
+
+    if (ImGui::Begin("Pattern Search"))
+    {
+        pattern_search_update();
+
+        ImGui::PushFont(actx.ui.fonts.mono);
+
+        float char_width = actx.ui.fonts.mono->Glyphs['x'].AdvanceX;
+
+        ImGui::SetNextItemWidth(12 * char_width);
+        bool search = ImGui::InputText("Pattern", _pattern, 63, ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SetItemTooltip("8 hex digits, ? matches any digit, e.g. 27bdff??");
+
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(12 * char_width);
+        ImGui::InputScalar("Mask", ImGuiDataType_U32, &_mask, nullptr, nullptr, "%08x",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SetItemTooltip("bits to compare, for fields that don't line up with hex digits");
+
+        ImGui::SameLine();
+        ImGui::RadioButton("Code", &_scope, (int)pattern_search_scope::Code);
+        ImGui::SameLine();
+        ImGui::RadioButton("Whole ELF", &_scope, (int)pattern_search_scope::Whole_Elf);
+
+        ImGui::SameLine();
+        search |= ImGui::Button("Search");
+
+        u32 value = 0;
+        u32 mask = 0;
+        bool valid = parse_search_pattern(_pattern, &value, &mask);
+
+        if (search && valid)
+            pattern_search_start(value, mask & _mask, (pattern_search_scope)_scope);
+
+        const array<pattern_match> *results = pattern_search_results();
+
+        if (!valid && _pattern[0] != '\0')
+            ImGui::TextDisabled("invalid pattern");
+        else if (pattern_search_running())
+            ImGui::ProgressBar(pattern_search_progress(), ImVec2(-FLT_MIN, 0),
+                               tformat("% matches", results->size).c_str);
+        else
+            ImGui::TextDisabled("%lld matches in %.2f ms", (long long)results->size,
+                                ns_to_ms(pattern_search_duration_ns()));
+
+        string line{};
+        line.allocator = actx.frame_alloc;
+
+        u32 clicked = max_value(u32);
+
+        if (ImGui::BeginChild("##matches"))
+        {
+            ImGuiListClipper clipper;
+            clipper.Begin((int)results->size);
+
+            while (clipper.Step())
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+            {
+                const pattern_match *m = results->data + i;
+                s64 index = m->vaddr == max_value(u32) ? -1 : instruction_index_by_vaddr(m->vaddr);
+
+                clear(&line);
+
+                instruction storage;
+
+                if (index >= 0)
+                    format_instruction(&line, instruction_at(index, &storage), nullptr);
+
+                ImGui::PushID(i);
+
+                const char *text = tformat("%08x %08x %-40s %s",
+                                           m->elf_offset, m->vaddr,
+                                           m->vaddr == max_value(u32) ? "" : function_offset_label(m->vaddr),
+                                           line.size > 0 ? line.data : "").c_str;
+
+                if (ImGui::Selectable(text) && m->vaddr != max_value(u32))
+                    clicked = m->vaddr;
+
+                ImGui::PopID();
+            }
+        }
+
+        ImGui::EndChild();
+
+        free(&line);
+
+        ImGui::PopFont();
+
+        if (clicked != max_value(u32))
+            goto_address(clicked);
+    }
+
+    ImGui::End();
+}
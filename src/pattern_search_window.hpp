@@ -0,0 +1,5 @@
+
+#pragma once
+
+// searches the module for masked 32-bit words, see pattern_search.hpp
+void pattern_search_window();
@@ -7,34 +7,54 @@
 #include "allegrexplorer_context.hpp"
 #include "popups.hpp"
 
-struct _goto_search_result
-{
-    u32 address;
-    const char *name;
-};
+#define GOTO_SEARCH_BUDGET 20000
+#define GOTO_RESULTS_HEIGHT 300.f
 
 struct _goto_data
 {
     char search_text[256] = {};
 
-    array<_goto_search_result> search_results;
+    search_query query;
+
+    // the search index changed since the query began, see popup_goto_reset
+    bool index_changed;
 };
 
+static _goto_data *goto_data = nullptr;
+
 static void init(_goto_data *data)
 {
     fill_memory(data, 0);
+    init(&data->query);
 }
 
 static void free(_goto_data *data)
 {
-    free(&data->search_results);
+    free(&data->query);
     fill_memory(data, 0);
 }
 
-bool popup_goto(u32 *out_addr)
+static const char *_search_match_name(search_match match)
 {
-    static _goto_data *goto_data = nullptr;
+    switch (match)
+    {
+    case search_match::Exact:     return "exact";
+    case search_match::Prefix:    return "prefix";
+    case search_match::Substring: return "substr";
+    case search_match::Fuzzy:     return "fuzzy";
+    }
+
+    return "";
+}
 
+void popup_goto_reset()
+{
+    if (goto_data != nullptr)
+        goto_data->index_changed = true;
+}
+
+bool popup_goto(u32 *out_addr)
+{
     if (goto_data == nullptr)
     {
         goto_data = alloc<_goto_data>();
@@ -51,29 +71,17 @@ bool popup_goto(u32 *out_addr)
 
     bool go = ImGui::InputText("##search", goto_data->search_text, 255, ImGuiInputTextFlags_EnterReturnsTrue);
 
-    if (ImGui::IsItemFocused() && ImGui::IsItemEdited())
-    {
-        clear(&goto_data->search_results);
-
-        if (!string_is_blank(goto_data->search_text))
-        {
-            // TODO: more sources of symbols
-            for_hash_table(addr, sym, &actx.disasm.psp_module.symbols)
-            {
-                if (string_begins_with(sym->name, goto_data->search_text))
-                    ::add_at_end(&goto_data->search_results, _goto_search_result{.address = *addr, .name = sym->name});
-            }
-        }
-
-        compare_function_p<_goto_search_result> compare_search_results =
-            [](const _goto_search_result *l, const _goto_search_result *r)
-            {
-                return compare_ascending(l->address, r->address);
-            };
+    search_index *index = &actx.analysis.search;
 
-        ::sort(goto_data->search_results.data, goto_data->search_results.size, compare_search_results);
+    if ((ImGui::IsItemFocused() && ImGui::IsItemEdited())
+     || goto_data->index_changed)
+    {
+        search_begin(&goto_data->query, index, goto_data->search_text);
+        goto_data->index_changed = false;
     }
 
+    search_step(&goto_data->query, index, GOTO_SEARCH_BUDGET);
+
     ImGui::SameLine();
 
     go |= ImGui::Button("Go");
@@ -94,35 +102,61 @@ bool popup_goto(u32 *out_addr)
             goto_cleanup(goto_data);
             return true;
         }
-        else
+        else if (goto_data->query.results.size > 0
+              && goto_data->query.results[0].entry < index->entries.size)
         {
-            // TODO: other sources of names
-            // input is text
-            for_hash_table(addr, sym, &actx.disasm.psp_module.symbols)
-            {
-                if (string_begins_with(sym->name, goto_data->search_text))
-                {
-                    *out_addr = *addr;
+            // input is text, take the best match
+            *out_addr = index->entries[goto_data->query.results[0].entry].address;
 
-                    goto_cleanup(goto_data);
-                    return true;
-                }
-            }
+            goto_cleanup(goto_data);
+            return true;
         }
     }
 
+    if (module_analyzing())
+        ImGui::TextDisabled("Analyzing... only addresses can be entered until it's done");
+    else if (!goto_data->query.done)
+        ImGui::TextDisabled("searching... %lld results", (long long)goto_data->query.results.size);
+    else
+        ImGui::TextDisabled("%lld results", (long long)goto_data->query.results.size);
+
+    const search_entry *clicked_result = nullptr;
+
     ImGui::PushFont(actx.ui.fonts.mono);
 
-    _goto_search_result *clicked_result = nullptr;
-    for_array(sr, &goto_data->search_results)
+    if (goto_data->query.results.size > 0)
     {
-        ImGui::Text("%08x", sr->address);
+        if (ImGui::BeginChild("##results", ImVec2(0, GOTO_RESULTS_HEIGHT)))
+        {
+            ImGuiListClipper clipper;
+            clipper.Begin((int)goto_data->query.results.size);
 
-        ImGui::SameLine();
+            while (clipper.Step())
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+            {
+                search_result *res = goto_data->query.results.data + i;
 
-        if (ImGui::Button(sr->name))
-            clicked_result = sr;
+                if (res->entry >= index->entries.size)
+                    continue;
+
+                const search_entry *entry = index->entries.data + res->entry;
+
+                ImGui::Text("%08x %-6s", entry->address, _search_match_name(res->match));
+
+                ImGui::SameLine();
+
+                ImGui::PushID(i);
+
+                if (ImGui::Button(entry->name))
+                    clicked_result = entry;
+
+                ImGui::PopID();
+            }
+        }
+
+        ImGui::EndChild();
     }
+
     ImGui::PopFont();
 
     if (clicked_result != nullptr)
@@ -9,3 +9,5 @@
 #define POPUP_ABOUT                 "About Allegrexplorer"
 
 bool popup_goto(u32 *out_addr);
+// restarts the search of an open goto popup, call when the search index changes
+void popup_goto_reset();
@@ -0,0 +1,226 @@
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h> // snprintf
+
+#include "imgui.h"
+
+#include "shl/string.hpp"
+
+#include "profiler.hpp"
+
+#define PROFILE_MAX_ENTRIES 64
+#define PROFILE_FRAME_HISTORY 240
+
+struct _profile_entry
+{
+    const char *name;
+    bool per_frame;
+
+    u64 last_ns;
+    u64 max_ns;
+    u64 total_ns;
+    s64 count;
+};
+
+struct _profile_data
+{
+    std::mutex mutex;
+
+    _profile_entry entries[PROFILE_MAX_ENTRIES];
+    s64 entry_count;
+
+    float frame_times[PROFILE_FRAME_HISTORY]; // ms
+    s64 frame_index;
+
+    s64 frame_arena_used;
+    s64 frame_arena_high_water;
+    s64 frame_arena_size;
+};
+
+static _profile_data _profile{};
+
+struct _counting_allocator_data
+{
+    allocator backing;
+
+    std::atomic<s64> bytes;
+    std::atomic<s64> count;
+};
+
+static _counting_allocator_data _counted{};
+
+static void _record(const char *name, u64 duration_ns, bool per_frame)
+{
+    std::lock_guard<std::mutex> lock(_profile.mutex);
+
+    _profile_entry *e = nullptr;
+
+    for (s64 i = 0; i < _profile.entry_count; ++i)
+    {
+        if (_profile.entries[i].per_frame == per_frame
+         && (_profile.entries[i].name == name || string_compare(_profile.entries[i].name, name) == 0))
+        {
+            e = _profile.entries + i;
+            break;
+        }
+    }
+
+    if (e == nullptr)
+    {
+        if (_profile.entry_count >= PROFILE_MAX_ENTRIES)
+            return;
+
+        e = _profile.entries + _profile.entry_count;
+        _profile.entry_count += 1;
+
+        *e = _profile_entry{};
+        e->name = name;
+        e->per_frame = per_frame;
+    }
+
+    e->last_ns = duration_ns;
+    e->total_ns += duration_ns;
+    e->count += 1;
+
+    if (duration_ns > e->max_ns)
+        e->max_ns = duration_ns;
+}
+
+void profile_record(const char *name, u64 duration_ns)
+{
+    _record(name, duration_ns, false);
+}
+
+void profile_record_frame(const char *name, u64 duration_ns)
+{
+    _record(name, duration_ns, true);
+}
+
+void profiler_frame_end(double dt, s64 frame_arena_used, s64 frame_arena_size)
+{
+    std::lock_guard<std::mutex> lock(_profile.mutex);
+
+    _profile.frame_times[_profile.frame_index] = (float)(dt * 1000.0);
+    _profile.frame_index = (_profile.frame_index + 1) % PROFILE_FRAME_HISTORY;
+
+    _profile.frame_arena_used = frame_arena_used;
+    _profile.frame_arena_size = frame_arena_size;
+
+    if (frame_arena_used > _profile.frame_arena_high_water)
+        _profile.frame_arena_high_water = frame_arena_used;
+}
+
+static void *_counting_alloc(void *context, void *ptr, s64 old_size, s64 new_size)
+{
+    _counting_allocator_data *data = (_counting_allocator_data*)context;
+    void *ret = data->backing.alloc(data->backing.context, ptr, old_size, new_size);
+
+    // failed, nothing changed
+    if (ret == nullptr && new_size > 0)
+        return ret;
+
+    if (ptr == nullptr)
+        old_size = 0;
+
+    if (ptr == nullptr && new_size > 0)
+        data->count += 1;
+    else if (ptr != nullptr && new_size == 0)
+        data->count -= 1;
+
+    data->bytes += new_size - old_size;
+
+    return ret;
+}
+
+allocator profiler_counting_allocator(allocator backing)
+{
+    _counted.backing = backing;
+
+    allocator ret{};
+    ret.alloc = _counting_alloc;
+    ret.context = &_counted;
+    return ret;
+}
+
+static void _entry_table(const char *id, bool per_frame)
+{
+    int flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+
+    if (!ImGui::BeginTable(id, 5, flags))
+        return;
+
+    ImGui::TableSetupColumn("Name");
+    ImGui::TableSetupColumn("Last (ms)");
+    ImGui::TableSetupColumn("Avg (ms)");
+    ImGui::TableSetupColumn("Max (ms)");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableHeadersRow();
+
+    for (s64 i = 0; i < _profile.entry_count; ++i)
+    {
+        _profile_entry *e = _profile.entries + i;
+
+        if (e->per_frame != per_frame)
+            continue;
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted(e->name);
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", ns_to_ms(e->last_ns));
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", ns_to_ms(e->total_ns) / (double)e->count);
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", ns_to_ms(e->max_ns));
+        ImGui::TableNextColumn(); ImGui::Text("%lld", (long long)e->count);
+    }
+
+    ImGui::EndTable();
+}
+
+void profiler_window()
+{
+    if (ImGui::Begin("Debug Info"))
+    {
+        std::lock_guard<std::mutex> lock(_profile.mutex);
+
+        // frame times
+        float avg = 0;
+        float worst = 0;
+
+        for (s64 i = 0; i < PROFILE_FRAME_HISTORY; ++i)
+        {
+            avg += _profile.frame_times[i];
+
+            if (_profile.frame_times[i] > worst)
+                worst = _profile.frame_times[i];
+        }
+
+        avg /= PROFILE_FRAME_HISTORY;
+
+        char overlay[64];
+        snprintf(overlay, 64, "avg %.2f ms, max %.2f ms", avg, worst);
+        ImGui::PlotLines("Frame time", _profile.frame_times, PROFILE_FRAME_HISTORY, (int)_profile.frame_index,
+                         overlay, 0.0f, Max(worst, 16.7f) * 1.2f, ImVec2(-1, 80));
+
+        if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Text("Frame arena: %lld / %lld bytes (high water %lld, %.1f%%)",
+                        (long long)_profile.frame_arena_used,
+                        (long long)_profile.frame_arena_size,
+                        (long long)_profile.frame_arena_high_water,
+                        _profile.frame_arena_size > 0
+                            ? 100.0 * (double)_profile.frame_arena_high_water / (double)_profile.frame_arena_size
+                            : 0.0);
+
+            ImGui::Text("Global allocator: %lld bytes in %lld allocations",
+                        (long long)_counted.bytes.load(),
+                        (long long)_counted.count.load());
+        }
+
+        if (ImGui::CollapsingHeader("Per frame", ImGuiTreeNodeFlags_DefaultOpen))
+            _entry_table("##profile_frame", true);
+
+        if (ImGui::CollapsingHeader("Load / analysis", ImGuiTreeNodeFlags_DefaultOpen))
+            _entry_table("##profile_load", false);
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,53 @@
+
+#pragma once
+
+// Lightweight instrumentation shown in the Debug Info window.
+// Load / analysis stages record how long their last run took, windows
+// record how long they took to build each frame.
+
+#include "shl/allocator.hpp"
+#include "shl/number_types.hpp"
+
+#include "timer.hpp"
+
+// thread safe, name must be a string literal / live forever
+void profile_record(const char *name, u64 duration_ns);
+// same, but shown under per-frame timings
+void profile_record_frame(const char *name, u64 duration_ns);
+
+struct _profile_scope
+{
+    const char *name;
+    u64 start;
+    bool per_frame;
+
+    _profile_scope(const char *_name, bool _per_frame)
+        : name(_name), start(time_now_ns()), per_frame(_per_frame) {}
+
+    ~_profile_scope()
+    {
+        u64 duration = time_now_ns() - start;
+
+        if (per_frame)
+            profile_record_frame(name, duration);
+        else
+            profile_record(name, duration);
+    }
+};
+
+#define _PROFILE_CONCAT2(A, B) A##B
+#define _PROFILE_CONCAT(A, B) _PROFILE_CONCAT2(A, B)
+
+// times the rest of the enclosing scope
+#define profile_scope(Name)       _profile_scope _PROFILE_CONCAT(_profile_, __LINE__)(Name, false)
+#define profile_frame_scope(Name) _profile_scope _PROFILE_CONCAT(_profile_, __LINE__)(Name, true)
+
+// call at the end of every frame with the frame delta time and the number of
+// bytes used in the frame arena.
+void profiler_frame_end(double dt, s64 frame_arena_used, s64 frame_arena_size);
+
+// wraps backing and counts the bytes and allocations that are live through
+// it, shown in the Debug Info window. thread safe if backing is.
+allocator profiler_counting_allocator(allocator backing);
+
+void profiler_window();
@@ -0,0 +1,353 @@
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "analysis.hpp"
+#include "search_index.hpp"
+
+// fuzzy matches beyond this many are dropped, there's no point in showing more
+#define SEARCH_MAX_FUZZY_RESULTS 1000
+
+static inline char _lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static inline u32 _trigram(const char *s)
+{
+    return ((u32)(u8)_lower(s[0]) << 16) | ((u32)(u8)_lower(s[1]) << 8) | (u32)(u8)_lower(s[2]);
+}
+
+static int _compare_names(const char *l, const char *r)
+{
+    while (*l != '\0' && _lower(*l) == _lower(*r))
+    {
+        ++l;
+        ++r;
+    }
+
+    return compare_ascending(_lower(*l), _lower(*r));
+}
+
+// position of needle in haystack, case-insensitive, or -1
+static s64 _find(const char *haystack, s64 haystack_length, const char *needle, s64 needle_length)
+{
+    for (s64 i = 0; i + needle_length <= haystack_length; ++i)
+    {
+        s64 j = 0;
+
+        while (j < needle_length && _lower(haystack[i + j]) == _lower(needle[j]))
+            ++j;
+
+        if (j == needle_length)
+            return i;
+    }
+
+    return -1;
+}
+
+// if needle is a subsequence of haystack (case-insensitive), returns true and
+// the length of the span that contains the match.
+static bool _fuzzy_match(const char *haystack, s64 haystack_length, const char *needle, s64 needle_length, u32 *out_span)
+{
+    s64 first = -1;
+    s64 j = 0;
+
+    for (s64 i = 0; i < haystack_length && j < needle_length; ++i)
+    {
+        if (_lower(haystack[i]) == _lower(needle[j]))
+        {
+            if (first < 0)
+                first = i;
+
+            j += 1;
+
+            if (j == needle_length)
+            {
+                *out_span = (u32)(i - first + 1);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void init(search_index *index)
+{
+    fill_memory(index, 0);
+}
+
+void free(search_index *index)
+{
+    free(&index->entries);
+    free(&index->trigram_keys);
+    free(&index->trigram_offsets);
+    free(&index->trigram_entries);
+}
+
+static void _add_entry(search_index *index, const char *name, u32 address)
+{
+    if (name == nullptr || name[0] == '\0')
+        return;
+
+    ::add_at_end(&index->entries, search_entry{name, address, (u32)string_length(name)});
+}
+
+void build_search_index(psp_disassembly *disasm, module_analysis *analysis, search_index *out)
+{
+    // every named instruction: symbols, import stubs and generated labels
+    for (s64 i = 0; i < analysis->labels.handles.size; ++i)
+        if (analysis->labels.handles.data[i] != 0)
+            _add_entry(out, label_table_get(&analysis->labels, i), analysis->instructions.addresses.data[i]);
+
+    // names of addresses that aren't disassembled instructions
+    for_hash_table(addr, sym, &disasm->psp_module.symbols)
+        if (analysis_instruction_index(analysis, disasm, *addr) < 0)
+            _add_entry(out, sym->name, *addr);
+
+    for_hash_table(addr, fimp, &disasm->psp_module.imports)
+        if (fimp->function != nullptr
+         && analysis_instruction_index(analysis, disasm, *addr) < 0)
+            _add_entry(out, fimp->function->name, *addr);
+
+    for_array(i, addr, &analysis->labels.outside_addresses)
+        _add_entry(out, string_pool_get(&analysis->labels.names, analysis->labels.outside_handles[i]), *addr);
+
+    compare_function_p<search_entry> compare_entries =
+        [](const search_entry *l, const search_entry *r)
+        {
+            int c = _compare_names(l->name, r->name);
+            return c != 0 ? c : compare_ascending(l->address, r->address);
+        };
+
+    ::sort(out->entries.data, out->entries.size, compare_entries);
+
+    // (trigram << 32) | entry, sorted, so entries of a trigram end up
+    // next to each other and in ascending order.
+    array<u64> pairs{};
+
+    for_array(e_i, e, &out->entries)
+        for (u32 i = 0; i + 3 <= e->name_length; ++i)
+            ::add_at_end(&pairs, ((u64)_trigram(e->name + i) << 32) | (u64)e_i);
+
+    compare_function_p<u64> compare_pairs =
+        [](const u64 *l, const u64 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(pairs.data, pairs.size, compare_pairs);
+
+    u64 last_pair = max_value(u64);
+
+    for_array(pair, &pairs)
+    {
+        if (*pair == last_pair)
+            continue; // same trigram more than once in a name
+
+        u32 key = (u32)(*pair >> 32);
+
+        if (out->trigram_keys.size == 0 || out->trigram_keys[out->trigram_keys.size - 1] != key)
+        {
+            ::add_at_end(&out->trigram_keys, key);
+            ::add_at_end(&out->trigram_offsets, (u32)out->trigram_entries.size);
+        }
+
+        ::add_at_end(&out->trigram_entries, (u32)(*pair & 0xffffffff));
+        last_pair = *pair;
+    }
+
+    ::add_at_end(&out->trigram_offsets, (u32)out->trigram_entries.size);
+
+    free(&pairs);
+}
+
+void init(search_query *query)
+{
+    fill_memory(query, 0);
+}
+
+void free(search_query *query)
+{
+    free(&query->results);
+}
+
+static void _sort_results(search_query *query)
+{
+    compare_function_p<search_result> compare_results =
+        [](const search_result *l, const search_result *r)
+        {
+            if (l->match != r->match)
+                return compare_ascending((u8)l->match, (u8)r->match);
+
+            if (l->score != r->score)
+                return compare_ascending(l->score, r->score);
+
+            // entries are sorted by name
+            return compare_ascending(l->entry, r->entry);
+        };
+
+    ::sort(query->results.data, query->results.size, compare_results);
+}
+
+static s64 _trigram_key_index(const search_index *index, u32 key)
+{
+    s64 lo = 0;
+    s64 hi = index->trigram_keys.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (index->trigram_keys.data[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < index->trigram_keys.size && index->trigram_keys.data[lo] == key)
+        return lo;
+
+    return -1;
+}
+
+void search_begin(search_query *query, const search_index *index, const char *text)
+{
+    clear(&query->results);
+    query->fuzzy_cursor = 0;
+    query->fuzzy_count = 0;
+    query->done = false;
+
+    query->text_length = Min((s64)string_length(text), (s64)255);
+    copy_memory(text, query->text, query->text_length);
+    query->text[query->text_length] = '\0';
+
+    const char *q = query->text;
+    s64 qlen = query->text_length;
+
+    if (qlen == 0)
+    {
+        query->done = true;
+        return;
+    }
+
+    // prefix matches: a contiguous range of the sorted entries
+    s64 lo = 0;
+    s64 hi = index->entries.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (_compare_names(index->entries.data[mid].name, q) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (s64 i = lo; i < index->entries.size; ++i)
+    {
+        const search_entry *e = index->entries.data + i;
+
+        if (e->name_length < qlen || _find(e->name, qlen, q, qlen) != 0)
+            break;
+
+        search_match match = e->name_length == qlen ? search_match::Exact : search_match::Prefix;
+        ::add_at_end(&query->results, search_result{(u32)i, match, e->name_length});
+    }
+
+    // substring matches: candidates from the rarest trigram of the query
+    if (qlen >= 3)
+    {
+        s64 best_key = -1;
+        u32 best_count = max_value(u32);
+
+        for (s64 i = 0; i + 3 <= qlen; ++i)
+        {
+            s64 k = _trigram_key_index(index, _trigram(q + i));
+
+            if (k < 0)
+            {
+                best_key = -1;
+                best_count = 0;
+                break;
+            }
+
+            u32 count = index->trigram_offsets.data[k + 1] - index->trigram_offsets.data[k];
+
+            if (count < best_count)
+            {
+                best_key = k;
+                best_count = count;
+            }
+        }
+
+        if (best_key >= 0)
+        {
+            for (u32 c = index->trigram_offsets.data[best_key]; c < index->trigram_offsets.data[best_key + 1]; ++c)
+            {
+                u32 entry = index->trigram_entries.data[c];
+                const search_entry *e = index->entries.data + entry;
+                s64 pos = _find(e->name, e->name_length, q, qlen);
+
+                // pos 0 was found as prefix already
+                if (pos > 0)
+                    ::add_at_end(&query->results, search_result{entry, search_match::Substring, (u32)pos});
+            }
+        }
+    }
+
+    _sort_results(query);
+}
+
+bool search_step(search_query *query, const search_index *index, s64 budget)
+{
+    if (query->done)
+        return true;
+
+    const char *q = query->text;
+    s64 qlen = query->text_length;
+    s64 end = Min(query->fuzzy_cursor + budget, index->entries.size);
+    bool added = false;
+
+    for (s64 i = query->fuzzy_cursor; i < end; ++i)
+    {
+        const search_entry *e = index->entries.data + i;
+        s64 pos = _find(e->name, e->name_length, q, qlen);
+
+        if (pos == 0)
+            continue; // prefix
+
+        if (pos > 0)
+        {
+            // short queries have no trigrams, so their substrings are found here
+            if (qlen < 3)
+            {
+                ::add_at_end(&query->results, search_result{(u32)i, search_match::Substring, (u32)pos});
+                added = true;
+            }
+
+            continue;
+        }
+
+        u32 span = 0;
+
+        if (query->fuzzy_count < SEARCH_MAX_FUZZY_RESULTS
+         && _fuzzy_match(e->name, e->name_length, q, qlen, &span))
+        {
+            ::add_at_end(&query->results, search_result{(u32)i, search_match::Fuzzy, span});
+            query->fuzzy_count += 1;
+            added = true;
+        }
+    }
+
+    query->fuzzy_cursor = end;
+    query->done = end >= index->entries.size;
+
+    if (added)
+        _sort_results(query);
+
+    return query->done;
+}
@@ -0,0 +1,76 @@
+
+#pragma once
+
+// Name search over all symbols, imports and generated labels of a module.
+// Built once at load: a case-insensitive sorted name array for prefix
+// matches and a trigram index for substring matches. Fuzzy (subsequence)
+// matches are found by an incremental scan so typing stays responsive.
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+
+struct search_entry
+{
+    const char *name; // lives as long as the module
+    u32 address;
+    u32 name_length;
+};
+
+struct search_index
+{
+    // sorted by name, case-insensitive
+    array<search_entry> entries;
+
+    // CSR: entries containing trigram_keys[i] are
+    // trigram_entries[trigram_offsets[i] .. trigram_offsets[i+1]]
+    array<u32> trigram_keys;
+    array<u32> trigram_offsets;
+    array<u32> trigram_entries;
+};
+
+void init(search_index *index);
+void free(search_index *index);
+
+// analysis must have its labels built already
+void build_search_index(psp_disassembly *disasm, module_analysis *analysis, search_index *out);
+
+enum class search_match : u8
+{
+    Exact,
+    Prefix,
+    Substring,
+    Fuzzy
+};
+
+struct search_result
+{
+    u32 entry; // index into search_index.entries
+    search_match match;
+    u32 score; // lower is better, within the same match type
+};
+
+struct search_query
+{
+    char text[256];
+    s64 text_length;
+
+    // ranked, best first
+    array<search_result> results;
+
+    // how far the fuzzy scan got
+    s64 fuzzy_cursor;
+    // fuzzy matches in results, capped at SEARCH_MAX_FUZZY_RESULTS
+    s64 fuzzy_count;
+    bool done;
+};
+
+void init(search_query *query);
+void free(search_query *query);
+
+// starts a new search, prefix and substring results are available immediately
+void search_begin(search_query *query, const search_index *index, const char *text);
+
+// scans up to budget more entries for fuzzy matches and re-ranks the results.
+// returns true once the search is complete.
+bool search_step(search_query *query, const search_index *index, s64 budget);
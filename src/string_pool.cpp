@@ -0,0 +1,37 @@
+
+#include "shl/memory.hpp"
+#include "shl/string.hpp"
+
+#include "string_pool.hpp"
+
+void init(string_pool *pool)
+{
+    fill_memory(pool, 0);
+    ::add_at_end(&pool->chars, '\0');
+}
+
+void free(string_pool *pool)
+{
+    free(&pool->chars);
+}
+
+u32 string_pool_add(string_pool *pool, const char *str)
+{
+    s64 size = (s64)string_length(str);
+
+    if (size == 0)
+        return 0;
+
+    u32 handle = string_pool_reserve(pool, size + 1);
+    copy_memory(str, pool->chars.data + handle, size + 1);
+
+    return handle;
+}
+
+u32 string_pool_reserve(string_pool *pool, s64 size)
+{
+    u32 handle = (u32)pool->chars.size;
+    ::resize(&pool->chars, pool->chars.size + size);
+
+    return handle;
+}
@@ -0,0 +1,27 @@
+
+#pragma once
+
+// NUL-terminated strings back to back in one buffer. Strings are referred
+// to by handle (their offset), which stays valid when the pool grows.
+// Handle 0 is always the empty string.
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+
+struct string_pool
+{
+    array<char> chars;
+};
+
+// adds the empty string
+void init(string_pool *pool);
+void free(string_pool *pool);
+
+u32 string_pool_add(string_pool *pool, const char *str);
+// reserves size bytes at the end of the pool, returns the handle of the first
+u32 string_pool_reserve(string_pool *pool, s64 size);
+
+inline const char *string_pool_get(const string_pool *pool, u32 handle)
+{
+    return pool->chars.data + handle;
+}
@@ -0,0 +1,156 @@
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "shl/assert.hpp"
+
+#include "thread_pool.hpp"
+
+struct _thread_pool_data
+{
+    std::thread *workers;
+    s32 worker_count;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    u64 generation;
+    bool quit;
+
+    // only one batch at a time
+    std::mutex submit_mutex;
+
+    // the current batch
+    parallel_for_function fn;
+    void *userdata;
+    s64 count;
+    std::atomic<s64> next;
+    s32 working;
+};
+
+static void _run_batch(_thread_pool_data *data)
+{
+    while (true)
+    {
+        s64 i = data->next.fetch_add(1);
+
+        if (i >= data->count)
+            break;
+
+        data->fn(i, data->userdata);
+    }
+}
+
+static void _worker_main(_thread_pool_data *data)
+{
+    u64 seen_generation = 0;
+
+    std::unique_lock<std::mutex> lock(data->mutex);
+
+    while (true)
+    {
+        data->wake.wait(lock, [&]() { return data->quit || data->generation != seen_generation; });
+
+        if (data->quit)
+            return;
+
+        seen_generation = data->generation;
+
+        lock.unlock();
+        _run_batch(data);
+        lock.lock();
+
+        data->working -= 1;
+
+        if (data->working == 0)
+            data->done.notify_all();
+    }
+}
+
+s32 hardware_thread_count()
+{
+    s32 ret = (s32)std::thread::hardware_concurrency();
+
+    return ret > 0 ? ret : 1;
+}
+
+void init(thread_pool *pool, s32 thread_count)
+{
+    assert(pool != nullptr);
+
+    if (thread_count <= 0)
+        thread_count = hardware_thread_count();
+
+    _thread_pool_data *data = new _thread_pool_data{};
+    data->worker_count = thread_count - 1;
+    data->workers = new std::thread[data->worker_count];
+
+    for (s32 i = 0; i < data->worker_count; ++i)
+        data->workers[i] = std::thread(_worker_main, data);
+
+    pool->data = data;
+    pool->thread_count = thread_count;
+}
+
+void free(thread_pool *pool)
+{
+    assert(pool != nullptr);
+
+    _thread_pool_data *data = pool->data;
+
+    if (data == nullptr)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(data->mutex);
+        data->quit = true;
+    }
+
+    data->wake.notify_all();
+
+    for (s32 i = 0; i < data->worker_count; ++i)
+        data->workers[i].join();
+
+    delete[] data->workers;
+    delete data;
+
+    pool->data = nullptr;
+    pool->thread_count = 0;
+}
+
+void parallel_for(thread_pool *pool, s64 count, parallel_for_function fn, void *userdata)
+{
+    if (count <= 0)
+        return;
+
+    if (pool == nullptr || pool->data == nullptr || pool->data->worker_count == 0 || count == 1)
+    {
+        for (s64 i = 0; i < count; ++i)
+            fn(i, userdata);
+
+        return;
+    }
+
+    _thread_pool_data *data = pool->data;
+
+    std::lock_guard<std::mutex> submit_lock(data->submit_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(data->mutex);
+        data->fn = fn;
+        data->userdata = userdata;
+        data->count = count;
+        data->next = 0;
+        data->working = data->worker_count;
+        data->generation += 1;
+    }
+
+    data->wake.notify_all();
+
+    _run_batch(data);
+
+    std::unique_lock<std::mutex> lock(data->mutex);
+    data->done.wait(lock, [&]() { return data->working == 0; });
+}
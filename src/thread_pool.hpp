@@ -0,0 +1,34 @@
+
+#pragma once
+
+// Small pool of worker threads for splitting analysis passes across cores.
+// Work is submitted as batches of indices via parallel_for, the calling
+// thread works on the batch too and returns once all indices are done.
+
+#include "shl/number_types.hpp"
+
+struct _thread_pool_data;
+
+struct thread_pool
+{
+    _thread_pool_data *data;
+    s32 thread_count; // including the thread calling parallel_for
+};
+
+// thread_count <= 0 uses the number of hardware threads
+void init(thread_pool *pool, s32 thread_count);
+void free(thread_pool *pool);
+
+s32 hardware_thread_count();
+
+typedef void (*parallel_for_function)(s64 index, void *userdata);
+
+// calls fn(i, userdata) for every i in [0, count), in no particular order.
+// only one batch runs on a pool at a time, concurrent callers wait for each other.
+void parallel_for(thread_pool *pool, s64 count, parallel_for_function fn, void *userdata);
+
+template<typename F>
+void parallel_for(thread_pool *pool, s64 count, F f)
+{
+    parallel_for(pool, count, [](s64 index, void *userdata) { (*(F*)userdata)(index); }, (void*)&f);
+}
@@ -0,0 +1,11 @@
+
+#include <chrono>
+
+#include "timer.hpp"
+
+u64 time_now_ns()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
@@ -0,0 +1,18 @@
+
+#pragma once
+
+// Monotonic clock for measuring durations.
+
+#include "shl/number_types.hpp"
+
+u64 time_now_ns();
+
+inline double ns_to_ms(u64 ns)
+{
+    return (double)ns / 1000000.0;
+}
+
+inline double ns_to_s(u64 ns)
+{
+    return (double)ns / 1000000000.0;
+}
@@ -0,0 +1,365 @@
+
+#include <string.h> // memcpy
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "module_loader.hpp"
+#include "workspace.hpp"
+
+// ELF32 program header type of loadable segments
+#define ELF_PT_LOAD 1
+
+// library entries with this attribute hold the module's own entry points,
+// which have the same NIDs in every module.
+#define EXPORT_ATTRIBUTE_SYSTEM 0x8000
+
+static inline u32 _read_u32(const u8 *p)
+{
+    u32 ret;
+    memcpy(&ret, p, sizeof(u32));
+    return ret; // the elf is little endian, like the hosts we build for
+}
+
+static inline u16 _read_u16(const u8 *p)
+{
+    u16 ret;
+    memcpy(&ret, p, sizeof(u16));
+    return ret;
+}
+
+// pointer to size bytes of the elf data at vaddr, going through the program
+// headers, or null if the range isn't in the file.
+static const u8 *_elf_vaddr_pointer(const psp_disassembly *disasm, u32 vaddr, u32 size)
+{
+    const u8 *elf = (const u8*)disasm->psp_module.elf_data;
+    u64 elf_size = (u64)disasm->psp_module.elf_size;
+
+    if (elf == nullptr || elf_size < 0x34)
+        return nullptr;
+
+    u32 phoff = _read_u32(elf + 0x1c);
+    u16 phentsize = _read_u16(elf + 0x2a);
+    u16 phnum = _read_u16(elf + 0x2c);
+
+    for (u16 i = 0; i < phnum; ++i)
+    {
+        u64 ph = (u64)phoff + (u64)i * phentsize;
+
+        if (ph + 0x14 > elf_size)
+            return nullptr;
+
+        const u8 *hdr = elf + ph;
+
+        if (_read_u32(hdr) != ELF_PT_LOAD)
+            continue;
+
+        u32 offset = _read_u32(hdr + 0x4);
+        u32 seg_vaddr = _read_u32(hdr + 0x8);
+        u32 filesz = _read_u32(hdr + 0x10);
+
+        if (vaddr < seg_vaddr || (u64)vaddr + size > (u64)seg_vaddr + filesz)
+            continue;
+
+        u64 at = (u64)offset + (vaddr - seg_vaddr);
+
+        if (at + size > elf_size)
+            return nullptr;
+
+        return elf + at;
+    }
+
+    return nullptr;
+}
+
+// library name at vaddr, or "" if it's not a terminated string in the file
+static const char *_elf_string(const psp_disassembly *disasm, u32 vaddr)
+{
+    const u8 *s = _elf_vaddr_pointer(disasm, vaddr, 1);
+
+    if (s == nullptr)
+        return "";
+
+    const u8 *elf_end = (const u8*)disasm->psp_module.elf_data + disasm->psp_module.elf_size;
+
+    for (const u8 *c = s; c < elf_end; ++c)
+        if (*c == '\0')
+            return (const char*)s;
+
+    return "";
+}
+
+void collect_module_exports(const psp_disassembly *disasm, array<module_export> *out)
+{
+    const prx_sce_module_info *info = &disasm->psp_module.module_info;
+    u32 at = info->export_offset_start;
+
+    while (at + 16 <= info->export_offset_end)
+    {
+        // SceLibraryEntryTable
+        const u8 *entry = _elf_vaddr_pointer(disasm, at, 16);
+
+        if (entry == nullptr)
+            break;
+
+        u32 name_vaddr = _read_u32(entry);
+        u16 attribute = _read_u16(entry + 6);
+        u8 entry_words = entry[8];
+        u8 var_count = entry[9];
+        u16 func_count = _read_u16(entry + 10);
+        u32 table_vaddr = _read_u32(entry + 12);
+
+        // entries are at least 4 words, anything shorter would never advance
+        at += Max((u32)entry_words, (u32)4) * (u32)sizeof(u32);
+
+        if ((attribute & EXPORT_ATTRIBUTE_SYSTEM) != 0 || func_count == 0)
+            continue;
+
+        // nids of functions and variables, followed by their addresses
+        u32 total = (u32)func_count + var_count;
+        const u8 *table = _elf_vaddr_pointer(disasm, table_vaddr, total * 2 * (u32)sizeof(u32));
+
+        if (table == nullptr)
+            continue;
+
+        const char *library = name_vaddr != 0 ? _elf_string(disasm, name_vaddr) : "";
+
+        for (u32 i = 0; i < func_count; ++i)
+        {
+            module_export exp;
+            exp.nid = _read_u32(table + i * sizeof(u32));
+            exp.address = _read_u32(table + (total + i) * sizeof(u32));
+            exp.library = library;
+            ::add_at_end(out, exp);
+        }
+    }
+}
+
+void module_memory_report(const psp_disassembly *disasm, const module_analysis *analysis, memory_report *out)
+{
+    fill_memory(out, 0);
+
+    memory_report_add(out, "ELF data", (s64)disasm->psp_module.elf_size);
+    memory_report_add(out, "Instructions", disasm->all_instructions.size * (s64)sizeof(instruction));
+    memory_report_add(out, "Jumps", disasm->all_jumps.size * (s64)sizeof(jump_destination));
+    analysis_memory_report(analysis, out);
+}
+
+void init(module_workspace *ws)
+{
+    fill_memory(ws, 0);
+    ws->active = -1;
+}
+
+static void _free_module(workspace_module *mod)
+{
+    // the loader frees the disassembly and analysis once the pass that's
+    // running is done, so closing doesn't wait for it.
+    if (mod->analyzing)
+        loader_drop_analysis(mod);
+
+    free(&mod->path);
+    free(&mod->exports);
+    free(&mod->analysis);
+    free(&mod->disasm);
+    delete mod;
+}
+
+void free(module_workspace *ws)
+{
+    for_array(mod, &ws->modules)
+        _free_module(*mod);
+
+    free(&ws->modules);
+    free(&ws->nid_index);
+    ws->active = -1;
+}
+
+static void _rebuild_nid_index(module_workspace *ws)
+{
+    clear(&ws->nid_index);
+
+    for_array(mod_i, mod, &ws->modules)
+    for_array(exp, &(*mod)->exports)
+        ::add_at_end(&ws->nid_index, nid_export{exp->nid, (s32)mod_i, exp->address});
+
+    compare_function_p<nid_export> compare_exports =
+        [](const nid_export *l, const nid_export *r)
+        {
+            if (l->nid != r->nid)
+                return compare_ascending(l->nid, r->nid);
+
+            return compare_ascending(l->module, r->module);
+        };
+
+    ::sort(ws->nid_index.data, ws->nid_index.size, compare_exports);
+}
+
+// moves the active module out of actx into its slot
+static void _park_active(module_workspace *ws)
+{
+    if (ws->active < 0)
+        return;
+
+    // windows and searches in progress refer to the active module
+    module_views_clear();
+
+    workspace_module *mod = ws->modules[ws->active];
+    mod->disasm = actx.disasm;
+    mod->analysis = actx.analysis;
+
+    // moved, not freed
+    actx.disasm = {};
+    actx.analysis = {};
+
+    ws->active = -1;
+}
+
+static void _unpark(module_workspace *ws, s64 index)
+{
+    workspace_module *mod = ws->modules[index];
+    actx.disasm = mod->disasm;
+    actx.analysis = mod->analysis;
+
+    mod->disasm = {};
+    mod->analysis = {};
+
+    ws->active = index;
+}
+
+static void _update_memory_report(workspace_module *mod, const psp_disassembly *disasm, const module_analysis *analysis)
+{
+    module_memory_report(disasm, analysis, &mod->memory);
+    memory_report_add(&mod->memory, "Exports", mod->exports.size * (s64)sizeof(module_export));
+}
+
+workspace_module *workspace_add_module(const char *path, psp_disassembly *disasm, module_analysis *analysis,
+                                       bool activate)
+{
+    module_workspace *ws = &actx.workspace;
+
+    for_array(i, mod, &ws->modules)
+    {
+        if (string_compare((*mod)->path.data, path) == 0)
+        {
+            workspace_close_module(i);
+            break;
+        }
+    }
+
+    workspace_module *mod = new workspace_module{};
+    string_set(&mod->path, path);
+    copy_memory(disasm->psp_module.module_info.name, mod->name, PRX_MODULE_NAME_LEN);
+    mod->name[PRX_MODULE_NAME_LEN] = '\0';
+    mod->instruction_count = analysis->instructions.addresses.size;
+    collect_module_exports(disasm, &mod->exports);
+    _update_memory_report(mod, disasm, analysis);
+
+    // ownership moves to the workspace
+    mod->disasm = *disasm;
+    mod->analysis = *analysis;
+    *disasm = {};
+    *analysis = {};
+
+    ::add_at_end(&ws->modules, mod);
+    _rebuild_nid_index(ws);
+
+    if (activate || ws->active < 0)
+        workspace_activate(ws->modules.size - 1);
+
+    return mod;
+}
+
+void workspace_activate(s64 index)
+{
+    module_workspace *ws = &actx.workspace;
+
+    if (index == ws->active || index < 0 || index >= ws->modules.size)
+        return;
+
+    _park_active(ws);
+    _unpark(ws, index);
+}
+
+void workspace_close_module(s64 index)
+{
+    module_workspace *ws = &actx.workspace;
+
+    if (index < 0 || index >= ws->modules.size)
+        return;
+
+    if (index == ws->active)
+        _park_active(ws);
+
+    _free_module(ws->modules[index]);
+
+    for (s64 i = index; i + 1 < ws->modules.size; ++i)
+        ws->modules[i] = ws->modules[i + 1];
+
+    ws->modules.size -= 1;
+
+    if (ws->active > index)
+        ws->active -= 1;
+
+    _rebuild_nid_index(ws);
+}
+
+void workspace_finish_module(workspace_module *mod, module_analysis *complete, bool release)
+{
+    module_workspace *ws = &actx.workspace;
+    psp_disassembly *disasm = &mod->disasm;
+    module_analysis *analysis = &mod->analysis;
+
+    if (ws->active >= 0 && ws->modules[ws->active] == mod)
+    {
+        // the cached lines point into the label names, which move
+        module_caches_clear();
+        disasm = &actx.disasm;
+        analysis = &actx.analysis;
+    }
+
+    // the borrowed analysis is freed by the loader
+    *analysis = *complete;
+    *complete = {};
+
+    if (release)
+        release_instructions(disasm);
+
+    mod->analyzing = false;
+    _update_memory_report(mod, disasm, analysis);
+}
+
+const nid_export *workspace_find_export(u32 nid, s64 exclude_module)
+{
+    const array<nid_export> *index = &actx.workspace.nid_index;
+
+    s64 lo = 0;
+    s64 hi = index->size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (index->data[mid].nid < nid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (s64 i = lo; i < index->size && index->data[i].nid == nid; ++i)
+        if (index->data[i].module != exclude_module)
+            return index->data + i;
+
+    return nullptr;
+}
+
+const nid_export *workspace_resolve_import(u32 vaddr)
+{
+    function_import *fimp = ::search(&actx.disasm.psp_module.imports, &vaddr);
+
+    if (fimp == nullptr || fimp->function == nullptr)
+        return nullptr;
+
+    return workspace_find_export(fimp->function->nid, actx.workspace.active);
+}
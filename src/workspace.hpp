@@ -0,0 +1,87 @@
+
+#pragma once
+
+// Set of loaded modules, e.g. an EBOOT and the PRX modules it loads.
+// One module is active at a time. Its disassembly and analysis live in
+// actx.disasm / actx.analysis so the windows don't have to know about the
+// workspace, the other modules are parked here until they're switched to.
+// Imports of the active module resolve to exports of the other loaded
+// modules through a NID index shared by the whole workspace.
+
+#include "shl/array.hpp"
+#include "shl/string.hpp"
+
+#include "allegrex/disassemble.hpp"
+
+#include "analysis.hpp"
+
+struct module_export
+{
+    u32 nid;
+    u32 address;
+    const char *library; // in the elf data of the module, never null
+};
+
+struct workspace_module
+{
+    string path;
+    char name[PRX_MODULE_NAME_LEN + 1];
+    s64 instruction_count;
+    memory_report memory;
+    array<module_export> exports;
+
+    // the late analysis passes are still running in the loader. until they're
+    // done, analysis only has the first passes and is borrowed from the loader.
+    bool analyzing;
+
+    // moved to actx while the module is active, empty in the meantime
+    psp_disassembly disasm;
+    module_analysis analysis;
+};
+
+struct nid_export
+{
+    u32 nid;
+    s32 module; // index into module_workspace.modules
+    u32 address;
+};
+
+struct module_workspace
+{
+    array<workspace_module*> modules;
+    s64 active; // -1 if there is none
+
+    // exports of all modules, sorted by nid, then module
+    array<nid_export> nid_index;
+};
+
+void init(module_workspace *ws);
+void free(module_workspace *ws);
+
+// exported functions of disasm, from the export table of its module info.
+// the module's own entry points (module_start etc.) are left out.
+void collect_module_exports(const psp_disassembly *disasm, array<module_export> *out);
+
+// bytes the disassembly and analysis of a module take up, by structure.
+// hash tables of liballegrex (symbols, imports) aren't counted.
+void module_memory_report(const psp_disassembly *disasm, const module_analysis *analysis, memory_report *out);
+
+// the following work on actx.workspace.
+
+// takes ownership of the module, replacing a loaded module with the same path.
+// if activate is set or no module is active, the module becomes the active one.
+workspace_module *workspace_add_module(const char *path, psp_disassembly *disasm, module_analysis *analysis,
+                                       bool activate);
+// makes modules[index] the active module, parking the current one
+void workspace_activate(s64 index);
+void workspace_close_module(s64 index);
+// replaces the borrowed analysis of a module that's analyzing with the
+// complete one, taking ownership of it. if release is set, the decoded
+// instructions are freed too, see compact_instructions.
+void workspace_finish_module(workspace_module *mod, module_analysis *complete, bool release);
+
+// first export of nid in a module other than exclude_module, or null
+const nid_export *workspace_find_export(u32 nid, s64 exclude_module);
+// export of another module that the import stub at vaddr of the active module
+// resolves to, or null
+const nid_export *workspace_resolve_import(u32 vaddr);
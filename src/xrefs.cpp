@@ -0,0 +1,211 @@
+
+#include "shl/compare.hpp"
+#include "shl/memory.hpp"
+
+#include "analysis.hpp"
+#include "thread_pool.hpp"
+#include "xrefs.hpp"
+
+void init(xref_index *xrefs)
+{
+    fill_memory(xrefs, 0);
+}
+
+void free(xref_index *xrefs)
+{
+    free(&xrefs->targets);
+    free(&xrefs->offsets);
+    free(&xrefs->sources);
+    free(&xrefs->types);
+}
+
+struct _import_stub
+{
+    const psp_function *function;
+    u32 address;
+};
+
+static u32 _import_stub_address(const array<_import_stub> *stubs, const psp_function *function)
+{
+    s64 lo = 0;
+    s64 hi = stubs->size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (stubs->data[mid].function < function)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < stubs->size && stubs->data[lo].function == function)
+        return stubs->data[lo].address;
+
+    return max_value(u32);
+}
+
+// (target << 32) | (source << 2) | type, sorting these sorts by target,
+// then source.
+static inline u64 _xref_key(u32 target, s64 source, xref_type type)
+{
+    return ((u64)target << 32) | ((u64)source << 2) | (u64)type;
+}
+
+void build_xref_index(psp_disassembly *disasm, module_analysis *analysis, xref_index *out, thread_pool *pool)
+{
+    array<_import_stub> stubs{};
+
+    for_hash_table(addr, fimp, &disasm->psp_module.imports)
+        ::add_at_end(&stubs, _import_stub{fimp->function, *addr});
+
+    compare_function_p<_import_stub> compare_stubs =
+        [](const _import_stub *l, const _import_stub *r)
+        {
+            return compare_ascending((u64)l->function, (u64)r->function);
+        };
+
+    ::sort(stubs.data, stubs.size, compare_stubs);
+
+    // one pass over the instructions, every chunk collects its own keys
+    s64 chunk_count = analysis->chunks.size;
+    array<array<u64>> chunk_keys{};
+
+    for (s64 c = 0; c < chunk_count; ++c)
+        ::add_at_end(&chunk_keys, array<u64>{});
+
+    parallel_for(pool, chunk_count, [disasm, analysis, &stubs, &chunk_keys](s64 chunk_index)
+    {
+        analysis_chunk *chunk = analysis->chunks.data + chunk_index;
+        array<u64> *keys = chunk_keys.data + chunk_index;
+        const u8 *flags = analysis->instructions.flags.data;
+
+        for (s64 i = chunk->from; i < chunk->to; ++i)
+        {
+            // most instructions refer to nothing, their structs aren't touched
+            if (!(flags[i] & (Instruction_Jump | Instruction_Branch | Instruction_Syscall)))
+                continue;
+
+            const instruction *instr = disasm->all_instructions.data + i;
+
+            for (u32 a = 0; a < instr->argument_count; ++a)
+            {
+                const instruction_argument *arg = instr->arguments + a;
+
+                switch (instr->argument_types[a])
+                {
+                case argument_type::Jump_Address:
+                    ::add_at_end(keys, _xref_key(arg->jump_address.data, i, xref_type::Jump));
+                    break;
+
+                case argument_type::Branch_Address:
+                    ::add_at_end(keys, _xref_key(arg->branch_address.data, i, xref_type::Branch));
+                    break;
+
+                case argument_type::PSP_Function_Pointer:
+                {
+                    u32 stub = _import_stub_address(&stubs, arg->psp_function_pointer);
+
+                    // the syscall inside the stub itself isn't a reference
+                    if (stub != max_value(u32) && (instr->address < stub || instr->address >= stub + 8))
+                        ::add_at_end(keys, _xref_key(stub, i, xref_type::Function_Pointer));
+
+                    break;
+                }
+
+                default:
+                    break;
+                }
+            }
+        }
+    });
+
+    s64 total = 0;
+
+    for_array(keys, &chunk_keys)
+        total += keys->size;
+
+    array<u64> all_keys{};
+    ::resize(&all_keys, total);
+
+    s64 offset = 0;
+
+    for_array(keys, &chunk_keys)
+    {
+        if (keys->size > 0)
+            copy_memory(keys->data, all_keys.data + offset, keys->size * (s64)sizeof(u64));
+
+        offset += keys->size;
+        free(keys);
+    }
+
+    free(&chunk_keys);
+    free(&stubs);
+
+    compare_function_p<u64> compare_keys =
+        [](const u64 *l, const u64 *r)
+        {
+            return compare_ascending(*l, *r);
+        };
+
+    ::sort(all_keys.data, all_keys.size, compare_keys);
+
+    ::resize(&out->sources, all_keys.size);
+    ::resize(&out->types, all_keys.size);
+
+    for_array(i, key, &all_keys)
+    {
+        u32 target = (u32)(*key >> 32);
+
+        if (out->targets.size == 0 || out->targets[out->targets.size - 1] != target)
+        {
+            ::add_at_end(&out->targets, target);
+            ::add_at_end(&out->offsets, (u32)i);
+        }
+
+        out->sources.data[i] = (u32)((*key & 0xffffffff) >> 2);
+        out->types.data[i] = (xref_type)(*key & 3);
+    }
+
+    ::add_at_end(&out->offsets, (u32)all_keys.size);
+
+    free(&all_keys);
+}
+
+xref_range xrefs_to(const xref_index *xrefs, u32 vaddr)
+{
+    s64 lo = 0;
+    s64 hi = xrefs->targets.size;
+
+    while (lo < hi)
+    {
+        s64 mid = lo + (hi - lo) / 2;
+
+        if (xrefs->targets.data[mid] < vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo >= xrefs->targets.size || xrefs->targets.data[lo] != vaddr)
+        return xref_range{nullptr, nullptr, 0};
+
+    u32 first = xrefs->offsets.data[lo];
+
+    return xref_range{xrefs->sources.data + first,
+                      xrefs->types.data + first,
+                      (s64)(xrefs->offsets.data[lo + 1] - first)};
+}
+
+const char *xref_type_name(xref_type type)
+{
+    switch (type)
+    {
+    case xref_type::Jump:             return "jump";
+    case xref_type::Branch:           return "branch";
+    case xref_type::Function_Pointer: return "syscall";
+    }
+
+    return "";
+}
@@ -0,0 +1,46 @@
+
+#pragma once
+
+// Cross references: for every address that is jumped or branched to, or
+// called through an import stub, the instructions referring to it.
+// Built once at load, CSR style: the references to targets[i] are
+// sources[offsets[i] .. offsets[i+1]], in ascending order.
+
+#include "allegrex/disassemble.hpp"
+
+struct module_analysis;
+struct thread_pool;
+
+enum class xref_type : u8
+{
+    Jump,
+    Branch,
+    Function_Pointer // syscall of an imported function, target is the import stub
+};
+
+struct xref_index
+{
+    array<u32> targets;     // sorted, unique
+    array<u32> offsets;     // targets.size + 1
+    array<u32> sources;     // indices into all_instructions
+    array<xref_type> types; // parallel to sources
+};
+
+void init(xref_index *xrefs);
+void free(xref_index *xrefs);
+
+// analysis must have its chunks built already
+void build_xref_index(psp_disassembly *disasm, module_analysis *analysis, xref_index *out, thread_pool *pool);
+
+// view into an xref_index, does not allocate
+struct xref_range
+{
+    const u32 *sources;
+    const xref_type *types;
+    s64 count;
+};
+
+// references to vaddr, binary search over the targets
+xref_range xrefs_to(const xref_index *xrefs, u32 vaddr);
+
+const char *xref_type_name(xref_type type);
@@ -0,0 +1,89 @@
+
+#include "imgui.h"
+
+#include "shl/format.hpp"
+#include "shl/string.hpp"
+
+#include "allegrexplorer_context.hpp"
+#include "disassembly_window.hpp"
+#include "instruction_format.hpp"
+#include "xrefs_window.hpp"
+
+void xrefs_window()
+{
+    // the address shown, follows gotos in the disassembly unless edited
+    static u32 _address = 0;
+    static u32 _followed_address = 0;
+
+    if (module_analyzing())
+    {
+        if (ImGui::Begin("Xrefs to"))
+            ImGui::TextDisabled("Analyzing...");
+
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Begin("Xrefs to"))
+    {
+        u32 current = disassembly_current_address();
+
+        if (current != _followed_address)
+        {
+            _followed_address = current;
+            _address = current;
+        }
+
+        ImGui::PushFont(actx.ui.fonts.mono);
+
+        float char_width = actx.ui.fonts.mono->Glyphs['x'].AdvanceX;
+        ImGui::SetNextItemWidth(12 * char_width);
+        ImGui::InputScalar("##address", ImGuiDataType_U32, &_address, nullptr, nullptr, "%08x",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+
+        xref_range xrefs = xrefs_to(&actx.analysis.xrefs, _address);
+
+        ImGui::SameLine();
+        ImGui::Text("%s, %lld xrefs", address_label(_address), (long long)xrefs.count);
+
+        string line{};
+        line.allocator = actx.frame_alloc;
+
+        u32 clicked = max_value(u32);
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)xrefs.count);
+
+        while (clipper.Step())
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            instruction storage;
+            instruction *instr = instruction_at(xrefs.sources[i], &storage);
+
+            clear(&line);
+            format_instruction(&line, instr, nullptr);
+
+            ImGui::PushID(i);
+
+            if (ImGui::Selectable(tformat("%08x %-7s %-40s %s", instr->address, xref_type_name(xrefs.types[i]),
+                                          function_offset_label(instr->address), line.data).c_str))
+                clicked = instr->address;
+
+            ImGui::PopID();
+        }
+
+        free(&line);
+
+        ImGui::PopFont();
+
+        if (clicked != max_value(u32))
+        {
+            goto_address(clicked);
+
+            // keep showing the xrefs we came from
+            _followed_address = disassembly_current_address();
+        }
+    }
+
+    ImGui::End();
+}
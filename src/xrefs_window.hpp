@@ -0,0 +1,5 @@
+
+#pragma once
+
+// lists the cross references to an address, follows the disassembly
+void xrefs_window();